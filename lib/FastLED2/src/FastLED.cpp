@@ -1,4 +1,5 @@
 #define FASTLED_INTERNAL
+#include <math.h>
 #include "FastLED.h"
 
 
@@ -20,6 +21,25 @@ CLEDController *CLEDController::m_pHead = NULL;
 CLEDController *CLEDController::m_pTail = NULL;
 static uint32_t lastshow = 0;
 
+const uint16_t LinearGammaTable[256] = {
+	0x0000, 0x0100, 0x0200, 0x0300, 0x0400, 0x0500, 0x0600, 0x0700, 0x0800, 0x0900, 0x0A00, 0x0B00, 0x0C00, 0x0D00, 0x0E00, 0x0F00,
+	0x1000, 0x1100, 0x1200, 0x1300, 0x1400, 0x1500, 0x1600, 0x1700, 0x1800, 0x1900, 0x1A00, 0x1B00, 0x1C00, 0x1D00, 0x1E00, 0x1F00,
+	0x2000, 0x2100, 0x2200, 0x2300, 0x2400, 0x2500, 0x2600, 0x2700, 0x2800, 0x2900, 0x2A00, 0x2B00, 0x2C00, 0x2D00, 0x2E00, 0x2F00,
+	0x3000, 0x3100, 0x3200, 0x3300, 0x3400, 0x3500, 0x3600, 0x3700, 0x3800, 0x3900, 0x3A00, 0x3B00, 0x3C00, 0x3D00, 0x3E00, 0x3F00,
+	0x4000, 0x4100, 0x4200, 0x4300, 0x4400, 0x4500, 0x4600, 0x4700, 0x4800, 0x4900, 0x4A00, 0x4B00, 0x4C00, 0x4D00, 0x4E00, 0x4F00,
+	0x5000, 0x5100, 0x5200, 0x5300, 0x5400, 0x5500, 0x5600, 0x5700, 0x5800, 0x5900, 0x5A00, 0x5B00, 0x5C00, 0x5D00, 0x5E00, 0x5F00,
+	0x6000, 0x6100, 0x6200, 0x6300, 0x6400, 0x6500, 0x6600, 0x6700, 0x6800, 0x6900, 0x6A00, 0x6B00, 0x6C00, 0x6D00, 0x6E00, 0x6F00,
+	0x7000, 0x7100, 0x7200, 0x7300, 0x7400, 0x7500, 0x7600, 0x7700, 0x7800, 0x7900, 0x7A00, 0x7B00, 0x7C00, 0x7D00, 0x7E00, 0x7F00,
+	0x8000, 0x8100, 0x8200, 0x8300, 0x8400, 0x8500, 0x8600, 0x8700, 0x8800, 0x8900, 0x8A00, 0x8B00, 0x8C00, 0x8D00, 0x8E00, 0x8F00,
+	0x9000, 0x9100, 0x9200, 0x9300, 0x9400, 0x9500, 0x9600, 0x9700, 0x9800, 0x9900, 0x9A00, 0x9B00, 0x9C00, 0x9D00, 0x9E00, 0x9F00,
+	0xA000, 0xA100, 0xA200, 0xA300, 0xA400, 0xA500, 0xA600, 0xA700, 0xA800, 0xA900, 0xAA00, 0xAB00, 0xAC00, 0xAD00, 0xAE00, 0xAF00,
+	0xB000, 0xB100, 0xB200, 0xB300, 0xB400, 0xB500, 0xB600, 0xB700, 0xB800, 0xB900, 0xBA00, 0xBB00, 0xBC00, 0xBD00, 0xBE00, 0xBF00,
+	0xC000, 0xC100, 0xC200, 0xC300, 0xC400, 0xC500, 0xC600, 0xC700, 0xC800, 0xC900, 0xCA00, 0xCB00, 0xCC00, 0xCD00, 0xCE00, 0xCF00,
+	0xD000, 0xD100, 0xD200, 0xD300, 0xD400, 0xD500, 0xD600, 0xD700, 0xD800, 0xD900, 0xDA00, 0xDB00, 0xDC00, 0xDD00, 0xDE00, 0xDF00,
+	0xE000, 0xE100, 0xE200, 0xE300, 0xE400, 0xE500, 0xE600, 0xE700, 0xE800, 0xE900, 0xEA00, 0xEB00, 0xEC00, 0xED00, 0xEE00, 0xEF00,
+	0xF000, 0xF100, 0xF200, 0xF300, 0xF400, 0xF500, 0xF600, 0xF700, 0xF800, 0xF900, 0xFA00, 0xFB00, 0xFC00, 0xFD00, 0xFE00, 0xFF00
+};
+
 // uint32_t CRGB::Squant = ((uint32_t)((__TIME__[4]-'0') * 28))<<16 | ((__TIME__[6]-'0')*50)<<8 | ((__TIME__[7]-'0')*28);
 
 CFastLED::CFastLED() {
@@ -49,7 +69,8 @@ void CFastLED::show(uint8_t scale) {
 	CLEDController *pCur = CLEDController::head();
 	while(pCur) {
 		uint8_t d = pCur->getDither();
-		if(m_nFPS < 100) { pCur->setDither(0); }
+		// Binary dithering flickers at low frame rates; sigma-delta carries its error per led and is left on
+		if(m_nFPS < 100 && d == BINARY_DITHER) { pCur->setDither(0); }
 		pCur->showLeds(scale);
 		pCur->setDither(d);
 		pCur = pCur->next();
@@ -57,6 +78,26 @@ void CFastLED::show(uint8_t scale) {
 	countFPS();
 }
 
+bool CFastLED::canShow() {
+	if(m_nMinMicros && ((micros()-lastshow) < m_nMinMicros)) { return false; }
+
+	CLEDController *pCur = CLEDController::head();
+	while(pCur) {
+		if(!pCur->ready()) { return false; }
+		pCur = pCur->next();
+	}
+	return true;
+}
+
+bool CFastLED::ditherPending() {
+	CLEDController *pCur = CLEDController::head();
+	while(pCur) {
+		if(pCur->ditherPending()) { return true; }
+		pCur = pCur->next();
+	}
+	return false;
+}
+
 int CFastLED::count() {
     int x = 0;
 	CLEDController *pCur = CLEDController::head();
@@ -86,7 +127,8 @@ void CFastLED::showColor(const struct CRGB & color, uint8_t scale) {
 	CLEDController *pCur = CLEDController::head();
 	while(pCur) {
 		uint8_t d = pCur->getDither();
-		if(m_nFPS < 100) { pCur->setDither(0); }
+		// Binary dithering flickers at low frame rates; sigma-delta carries its error per led and is left on
+		if(m_nFPS < 100 && d == BINARY_DITHER) { pCur->setDither(0); }
 		pCur->showColor(color, scale);
 		pCur->setDither(d);
 		pCur = pCur->next();
@@ -137,6 +179,32 @@ void CFastLED::setCorrection(const struct CRGB & correction) {
 	}
 }
 
+CLEDController & CLEDController::setGamma(float gamma) {
+	m_Gamma = gamma;
+	if(gamma == 1.0f) {
+		delete [] m_pGammaTable;
+		m_pGammaTable = NULL;
+		return *this;
+	}
+
+	if(!m_pGammaTable) {
+		m_pGammaTable = new uint16_t[256];
+		if(!m_pGammaTable) { m_Gamma = 1.0f; return *this; }
+	}
+	for(int i = 0; i < 256; i++) {
+		m_pGammaTable[i] = (uint16_t)(pow(i / 255.0f, gamma) * 0xFF00 + 0.5f);
+	}
+	return *this;
+}
+
+void CFastLED::setGamma(float gamma) {
+	CLEDController *pCur = CLEDController::head();
+	while(pCur) {
+		pCur->setGamma(gamma);
+		pCur = pCur->next();
+	}
+}
+
 void CFastLED::setDither(uint8_t ditherMode)  {
 	CLEDController *pCur = CLEDController::head();
 	while(pCur) {
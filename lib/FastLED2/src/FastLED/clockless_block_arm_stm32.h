@@ -0,0 +1 @@
+#include "../clockless_block_arm_stm32.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../clockless_dma_arm_stm32.h"
\ No newline at end of file
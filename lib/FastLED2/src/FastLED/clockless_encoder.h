@@ -0,0 +1 @@
+#include "../clockless_encoder.h"
\ No newline at end of file
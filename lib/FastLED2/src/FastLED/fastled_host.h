@@ -0,0 +1 @@
+#include "../fastled_host.h"
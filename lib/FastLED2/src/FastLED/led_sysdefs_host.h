@@ -0,0 +1 @@
+#include "../led_sysdefs_host.h"
@@ -0,0 +1 @@
+#include "../lib8tion_x4.h"
\ No newline at end of file
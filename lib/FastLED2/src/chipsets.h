@@ -546,6 +546,11 @@ class WS2812Controller800Khz : public ClocklessController<DATA_PIN, NS(250), NS(
 #warning "Not enough clock cycles available for the WS2812 (800khz)"
 #endif
 
+#ifdef FASTLED_HAS_DMA_CLOCKLESS
+template <uint8_t DATA_PIN, EOrder RGB_ORDER = RGB>
+class WS2812DMAController800Khz : public ClocklessDMAController<DATA_PIN, NS(250), NS(625), NS(375), RGB_ORDER> {};
+#endif
+
 // WS2811@400khz - 800ns, 800ns, 900ns
 template <uint8_t DATA_PIN, EOrder RGB_ORDER = RGB>
 class WS2811Controller400Khz : public ClocklessController<DATA_PIN, NS(800), NS(800), NS(900), RGB_ORDER> {};
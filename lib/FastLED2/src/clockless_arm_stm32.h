@@ -1,6 +1,8 @@
 #ifndef __INC_CLOCKLESS_ARM_STM32_H
 #define __INC_CLOCKLESS_ARM_STM32_H
 
+#include "clockless_encoder.h"
+
 FASTLED_NAMESPACE_BEGIN
 // Definition for a single channel clockless controller for the stm32 family of chips, like that used in the spark core
 // See clockless.h for detailed info on how the template parameters are used.
@@ -18,11 +20,17 @@ template <int DATA_PIN, int T1, int T2, int T3, EOrder RGB_ORDER = RGB, int XTRA
 class ClocklessController : public CLEDController {
   typedef typename FastPin<DATA_PIN>::port_ptr_t data_ptr_t;
   typedef typename FastPin<DATA_PIN>::port_t data_t;
+  // High times in cpu cycles, measured from the rising edge, with the same adjustments the bit loop always used
+  typedef ClocklessTimerEncoder<T1-(ADJ/2), T2-(ADJ/2), T3+ADJ, 1> Encoder;
 
   data_t mPinMask;
   data_ptr_t mPort;
   CMinWait<WAIT_TIME> mWait;
+  uint8_t *mFrame;
+  int mFrameSize;
 public:
+  ClocklessController() : mFrame(NULL), mFrameSize(0) {}
+
   virtual void init() {
     FastPin<DATA_PIN>::setOutput();
     mPinMask = FastPin<DATA_PIN>::mask();
@@ -33,117 +41,108 @@ public:
     showColor(CRGB(0, 0, 0), nLeds, 0);
   }
 
+  virtual bool ready() { return mWait.ready(); }
+
 protected:
 
   // set all the leds on the controller to a given color
   virtual void showColor(const struct CRGB & rgbdata, int nLeds, CRGB scale) {
-    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither());
+    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
 
+    int nBytes = encode(pixels);
     mWait.wait();
-    showRGBInternal(pixels);
+    showRGBInternal(mFrame, nBytes);
     mWait.mark();
   }
 
   virtual void show(const struct CRGB *rgbdata, int nLeds, CRGB scale) {
-    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither());
+    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
 
+    int nBytes = encode(pixels);
     mWait.wait();
-    showRGBInternal(pixels);
+    showRGBInternal(mFrame, nBytes);
     mWait.mark();
   }
 
   #ifdef SUPPORT_ARGB
   virtual void show(const struct CARGB *rgbdata, int nLeds, CRGB scale) {
-    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither());
+    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
+    int nBytes = encode(pixels);
     mWait.wait();
-    showRGBInternal(pixels);
+    showRGBInternal(mFrame, nBytes);
     mWait.mark();
   }
   #endif
 
+  // Scale and dither the whole frame into wire order before interrupts go off, so the bit loop only has to pick
+  // between two high times.  Returns the number of bytes to send.
+  int encode(PixelController<RGB_ORDER> & pixels) {
+    int size = pixels.mLen * 3;
+    if(size > mFrameSize) {
+      delete [] mFrame;
+      mFrame = new uint8_t[size];
+      mFrameSize = mFrame ? size : 0;
+      if(!mFrame) { return 0; }
+    }
+    return loadAndScaleFrame(pixels, mFrame) - mFrame;
+  }
+
 #define _CYCCNT (*(volatile uint32_t*)(0xE0001004UL))
 
-  template<int BITS> __attribute__ ((always_inline)) inline static void writeBits(register uint32_t & next_mark, register data_ptr_t port, register data_t hi, register data_t lo, register uint8_t & b)  {
-    for(register uint32_t i = BITS-1; i > 0; i--) {
-      while(_CYCCNT < (T1+T2+T3-ADJ));
+  // The cycle counter is left free running (System.ticks() and micros() are built on it), so marks are compared
+  // with wrapping subtraction instead of resetting it for every bit.  Any XTRA0 bits past the byte shift in as 0s.
+  template<int BITS> __attribute__ ((always_inline)) inline static void writeBits(register uint32_t & next_mark, register data_ptr_t port, register data_t hi, register data_t lo, register uint32_t b)  {
+    for(register uint32_t i = 0; i < BITS; i++) {
+      while((int32_t)(_CYCCNT - next_mark) < 0);
       FastPin<DATA_PIN>::fastset(port, hi);
-      _CYCCNT = 4;
-      if(b&0x80) {
-        while(_CYCCNT < (T1+T2-ADJ));
-        FastPin<DATA_PIN>::fastset(port, lo);
-      } else {
-        while(_CYCCNT < (T1-(ADJ/2)));
-        FastPin<DATA_PIN>::fastset(port, lo);
-      }
+      register uint32_t start = _CYCCNT;
+      next_mark = start + (T1+T2+T3-ADJ);
+      register uint32_t high = (b & 0x80) ? Encoder::ONE_HIGH : Encoder::ZERO_HIGH;
       b <<= 1;
-    }
-
-    while(_CYCCNT < (T1+T2+T3-ADJ));
-    FastPin<DATA_PIN>::fastset(port, hi);
-    _CYCCNT = 4;
-
-    if(b&0x80) {
-      while(_CYCCNT < (T1+T2-ADJ));
-      FastPin<DATA_PIN>::fastset(port, lo);
-    } else {
-      while(_CYCCNT < (T1-(ADJ/2)));
+      while((_CYCCNT - start) < high);
       FastPin<DATA_PIN>::fastset(port, lo);
     }
   }
 
   // This method is made static to force making register Y available to use for data on AVR - if the method is non-static, then
   // gcc will use register Y for the this pointer.
-  static uint32_t showRGBInternal(PixelController<RGB_ORDER> & pixels) {
+  static uint32_t showRGBInternal(register const uint8_t *data, int nBytes) {
     // Get access to the clock
     CoreDebug->DEMCR  |= CoreDebug_DEMCR_TRCENA_Msk;
     DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
-    DWT->CYCCNT = 0;
+    uint32_t begin = DWT->CYCCNT;
 
     register data_ptr_t port = FastPin<DATA_PIN>::port();
     register data_t hi = *port | FastPin<DATA_PIN>::mask();;
     register data_t lo = *port & ~FastPin<DATA_PIN>::mask();;
     *port = lo;
 
-    // Setup the pixel controller and load/scale the first byte
-    pixels.preStepFirstByteDithering();
-    register uint8_t b = pixels.loadAndScale0();
+    const uint8_t *end = data + nBytes;
 
     cli();
 
-    uint32_t next_mark = (T1+T2+T3);
+    uint32_t next_mark = DWT->CYCCNT + (T1+T2+T3);
 
-    DWT->CYCCNT = 0;
-    while(pixels.has(1)) {
-      pixels.stepDithering();
+    while(data < end) {
       #if (FASTLED_ALLOW_INTERRUPTS == 1)
       cli();
       // if interrupts took longer than 45µs, punt on the current frame
-      if(DWT->CYCCNT > next_mark) {
-        if((DWT->CYCCNT-next_mark) > ((WAIT_TIME-INTERRUPT_THRESHOLD)*CLKS_PER_US)) { sei(); return DWT->CYCCNT; }
-      }
+      if((int32_t)(DWT->CYCCNT - next_mark) > (int32_t)((WAIT_TIME-INTERRUPT_THRESHOLD)*CLKS_PER_US)) { sei(); return DWT->CYCCNT - begin; }
 
       hi = *port | FastPin<DATA_PIN>::mask();
       lo = *port & ~FastPin<DATA_PIN>::mask();
       #endif
 
-      // Write first byte, read next byte
-      writeBits<8+XTRA0>(next_mark, port, hi, lo, b);
-      b = pixels.loadAndScale1();
-
-      // Write second byte, read 3rd byte
-      writeBits<8+XTRA0>(next_mark, port, hi, lo, b);
-      b = pixels.loadAndScale2();
-
-      // Write third byte, read 1st byte of next pixel
-      writeBits<8+XTRA0>(next_mark, port, hi, lo, b);
-      b = pixels.advanceAndLoadAndScale0();
+      writeBits<8+XTRA0>(next_mark, port, hi, lo, *data++);
+      writeBits<8+XTRA0>(next_mark, port, hi, lo, *data++);
+      writeBits<8+XTRA0>(next_mark, port, hi, lo, *data++);
       #if (FASTLED_ALLOW_INTERRUPTS == 1)
       sei();
       #endif
     };
 
     sei();
-    return DWT->CYCCNT;
+    return DWT->CYCCNT - begin;
   }
 };
 
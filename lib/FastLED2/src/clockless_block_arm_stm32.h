@@ -0,0 +1,182 @@
+#ifndef __INC_CLOCKLESS_BLOCK_ARM_STM32_H
+#define __INC_CLOCKLESS_BLOCK_ARM_STM32_H
+
+#include "clockless_encoder.h"
+
+FASTLED_NAMESPACE_BEGIN
+// Parallel clockless output for the photon.  D0-D4 are GPIOB bits 7-3, so up to five strips can be clocked out
+// together with one write to the port's BSRR register per edge: every lane goes high at the start of a bit, lanes
+// sending a 0 drop after T1 and the rest after T1+T2.  Wire time depends on the length of a lane, not on how
+// many lanes there are.  The led data is split into one block per lane, the way MultiPixelController lays it out.
+
+#define FASTLED_HAS_BLOCKLESS 1
+
+#define PORTB_FIRST_PIN 0
+#define BLOCK_LAST_PIN 4
+
+#ifndef _CYCCNT
+#define _CYCCNT (*(volatile uint32_t*)(0xE0001004UL))
+#endif
+
+/// Masks and setup for LANES consecutive pins starting at PIN.
+template<int PIN, int LANES> struct _BlockPins {
+  static inline uint32_t mask() { return FastPin<PIN>::mask() | _BlockPins<PIN + 1, LANES - 1>::mask(); }
+  static inline void setOutput() { FastPin<PIN>::setOutput(); _BlockPins<PIN + 1, LANES - 1>::setOutput(); }
+  static inline void laneMasks(uint8_t *out) { *out = FastPin<PIN>::mask(); _BlockPins<PIN + 1, LANES - 1>::laneMasks(out + 1); }
+};
+
+template<int PIN> struct _BlockPins<PIN, 0> {
+  static inline uint32_t mask() { return 0; }
+  static inline void setOutput() {}
+  static inline void laneMasks(uint8_t *out) {}
+};
+
+template <uint8_t LANES, int FIRST_PIN, int T1, int T2, int T3, EOrder RGB_ORDER = GRB, int XTRA0 = 0, bool FLIP = false, int WAIT_TIME = 50>
+class InlineBlockClocklessController : public CLEDController {
+  typedef _BlockPins<FIRST_PIN, LANES> Pins;
+  typedef MultiPixelController<LANES, (1 << LANES) - 1, RGB_ORDER> Pixels;
+  // Same cycle adjustments as the single lane controller
+  typedef ClocklessTimerEncoder<T1-(ADJ/2), T2-(ADJ/2), T3+ADJ, 1> Encoder;
+
+  static_assert(LANES > 0 && FIRST_PIN >= 0 && FIRST_PIN + LANES - 1 <= BLOCK_LAST_PIN,
+                "block output lanes must be on D0-D4, which share GPIOB");
+
+  // Port bit of each lane; D0-D4 are all within the low byte of GPIOB
+  uint8_t mLaneMask[LANES];
+  CMinWait<WAIT_TIME> mWait;
+  // For every bit of every byte slot, the port bits of the lanes sending a 0
+  uint8_t *mPlanes;
+  int mPlanesSize;
+
+public:
+  InlineBlockClocklessController() : mPlanes(NULL), mPlanesSize(0) {}
+
+  virtual void init() {
+    Pins::setOutput();
+    Pins::laneMasks(mLaneMask);
+  }
+
+  virtual void clearLeds(int nLeds) {
+    showColor(CRGB(0, 0, 0), nLeds, 0);
+  }
+
+  virtual bool ready() { return mWait.ready(); }
+
+protected:
+
+  virtual void showColor(const struct CRGB & rgbdata, int nLeds, CRGB scale) {
+    Pixels pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
+    showPixels(pixels);
+  }
+
+  virtual void show(const struct CRGB *rgbdata, int nLeds, CRGB scale) {
+    Pixels pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
+    showPixels(pixels);
+  }
+
+  #ifdef SUPPORT_ARGB
+  virtual void show(const struct CARGB *rgbdata, int nLeds, CRGB scale) {
+    Pixels pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
+    showPixels(pixels);
+  }
+  #endif
+
+private:
+  void showPixels(Pixels & pixels) {
+    int nSlots = encode(pixels);
+    mWait.wait();
+    showRGBInternal(mPlanes, nSlots);
+    mWait.mark();
+  }
+
+  // Scale, dither and transpose the frame before interrupts go off, so the bit loop is only port writes.
+  // Returns the number of byte slots (3 per pixel) to send.
+  int encode(Pixels & pixels) {
+    int size = pixels.mLen * 3 * 8;
+    if(size > mPlanesSize) {
+      delete [] mPlanes;
+      mPlanes = new uint8_t[size];
+      mPlanesSize = mPlanes ? size : 0;
+      if(!mPlanes) { return 0; }
+    }
+
+    uint8_t *out = mPlanes;
+    while(pixels.has(1)) {
+      pixels.stepDithering();
+      out = transpose<0>(pixels, out);
+      out = transpose<1>(pixels, out);
+      out = transpose<2>(pixels, out);
+      pixels.advanceData();
+    }
+    return (out - mPlanes) / 8;
+  }
+
+  template<int SLOT> inline uint8_t *transpose(Pixels & pixels, uint8_t *out) {
+    for(int i = 0; i < 8; i++) { out[i] = 0; }
+    for(int lane = 0; lane < LANES; lane++) {
+      uint8_t b = Pixels::template loadAndScale<SLOT>(pixels, lane);
+      for(int i = 0; i < 8; i++) {
+        if(!(b & 0x80)) { out[i] |= mLaneMask[lane]; }
+        b <<= 1;
+      }
+    }
+    return out + 8;
+  }
+
+  // BSRRL/BSRRH sit right after ODR and together make up the 32 bit BSRR: the low half sets bits, the high
+  // half clears them
+  static inline volatile uint32_t *bsrr() { return FastPin<FIRST_PIN>::port() + 1; }
+
+  template<int BITS> __attribute__ ((always_inline)) inline static void writeBits(register uint32_t & next_mark, register volatile uint32_t *port, register uint32_t all, register const uint8_t *zeros) {
+    for(register uint32_t i = 0; i < BITS; i++) {
+      register uint32_t zero = (i < 8 ? zeros[i] : all) << 16;
+      while((int32_t)(_CYCCNT - next_mark) < 0);
+      *port = all;
+      register uint32_t start = _CYCCNT;
+      next_mark = start + (T1+T2+T3-ADJ);
+      while((_CYCCNT - start) < Encoder::ZERO_HIGH);
+      *port = zero;
+      while((_CYCCNT - start) < Encoder::ONE_HIGH);
+      *port = all << 16;
+    }
+  }
+
+  static uint32_t showRGBInternal(register const uint8_t *planes, int nSlots) {
+    // Get access to the clock
+    CoreDebug->DEMCR  |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    uint32_t begin = DWT->CYCCNT;
+
+    register volatile uint32_t *port = bsrr();
+    register uint32_t all = Pins::mask();
+    *port = all << 16;
+
+    const uint8_t *end = planes + nSlots * 8;
+
+    cli();
+
+    uint32_t next_mark = DWT->CYCCNT + (T1+T2+T3);
+
+    while(planes < end) {
+      #if (FASTLED_ALLOW_INTERRUPTS == 1)
+      cli();
+      // if interrupts took longer than 45µs, punt on the current frame
+      if((int32_t)(DWT->CYCCNT - next_mark) > (int32_t)((WAIT_TIME-INTERRUPT_THRESHOLD)*CLKS_PER_US)) { sei(); return DWT->CYCCNT - begin; }
+      #endif
+
+      writeBits<8+XTRA0>(next_mark, port, all, planes); planes += 8;
+      writeBits<8+XTRA0>(next_mark, port, all, planes); planes += 8;
+      writeBits<8+XTRA0>(next_mark, port, all, planes); planes += 8;
+      #if (FASTLED_ALLOW_INTERRUPTS == 1)
+      sei();
+      #endif
+    };
+
+    sei();
+    return DWT->CYCCNT - begin;
+  }
+};
+
+FASTLED_NAMESPACE_END
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef __INC_CLOCKLESS_DMA_ARM_STM32_H
+#define __INC_CLOCKLESS_DMA_ARM_STM32_H
+
+#include "clockless_encoder.h"
+
+FASTLED_NAMESPACE_BEGIN
+// Clockless controller for the photon (stm32f2) that lets a timer generate the waveform.  The timer runs in pwm
+// mode with one period per bit, and DMA feeds it the compare value (high time) for each bit from a small ring
+// of two halves.  While one half is streaming, the half/full transfer interrupt encodes the next few pixels into
+// the other one, so the cpu only pays for encoding and show() returns as soon as the transfer has started.
+
+#define FASTLED_HAS_DMA_CLOCKLESS 1
+
+// Timers 3 and 4 sit on APB1, which the photon clocks at 30MHz, so the timers tick at 60MHz
+#define DMA_CLOCKLESS_CLOCKS_PER_TICK (F_CPU / 60000000)
+
+/// Timer channel and DMA stream behind a pin.  The stream is the one carrying the timer's update requests, so
+/// pins sharing a timer (D0/D1, D2/D3) can't both drive a DMA controller.
+template<uint8_t PIN> struct DMAPin { enum { HAS_TIMER = 0 }; };
+
+#define _DEFDMAPIN(PIN, BIT, L, T, CH, STREAM, DMACH) template<> struct DMAPin<PIN> { \
+  enum { HAS_TIMER = 1, BIT_NUMBER = BIT, CHANNEL = CH, STREAM_INDEX = STREAM, DMA_CHANNEL = DMACH }; \
+  static inline GPIO_TypeDef *gpio() { return GPIO ## L; } \
+  static inline TIM_TypeDef *timer() { return TIM ## T; } \
+  static inline DMA_Stream_TypeDef *stream() { return DMA1_Stream ## STREAM; } \
+  static inline IRQn_Type irq() { return DMA1_Stream ## STREAM ## _IRQn; } \
+  static inline void enableClocks() { RCC->APB1ENR |= RCC_APB1ENR_TIM ## T ## EN; RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN; } \
+};
+
+_DEFDMAPIN(0, 7, B, 4, 2, 6, 2);
+_DEFDMAPIN(1, 6, B, 4, 1, 6, 2);
+_DEFDMAPIN(2, 5, B, 3, 2, 2, 5);
+_DEFDMAPIN(3, 4, B, 3, 1, 2, 5);
+
+template <int DATA_PIN, int T1, int T2, int T3, EOrder RGB_ORDER = RGB, int WAIT_TIME = 50, int HALF_PIXELS = 8>
+class ClocklessDMAController : public CLEDController {
+  typedef DMAPin<DATA_PIN> Pin;
+  typedef ClocklessTimerEncoder<T1, T2, T3, DMA_CLOCKLESS_CLOCKS_PER_TICK> Encoder;
+
+  static_assert(Pin::HAS_TIMER, "pin has no timer channel usable for dma output");
+
+  enum { HALF_SIZE = HALF_PIXELS * 24, RING_SIZE = HALF_SIZE * 2 };
+  // Stream flags live in LISR/HISR at these offsets
+  enum { FLAG_SHIFT = (Pin::STREAM_INDEX & 3) == 0 ? 0 : (Pin::STREAM_INDEX & 3) == 1 ? 6 : (Pin::STREAM_INDEX & 3) == 2 ? 16 : 22 };
+
+  static ClocklessDMAController *sActive;
+
+  // compare registers must be written a halfword at a time
+  uint16_t mRing[RING_SIZE];
+  uint8_t *mStaging;
+  int mStagingSize;
+  const uint8_t *mNext;
+  volatile int mPixelsLeft;
+  volatile uint8_t mLatchHalves;
+  volatile bool mBusy;
+  CMinWait<WAIT_TIME> mWait;
+
+public:
+  ClocklessDMAController() : mStaging(NULL), mStagingSize(0), mNext(NULL), mPixelsLeft(0), mLatchHalves(0), mBusy(false) {}
+
+  virtual void init() {
+    sActive = this;
+    Pin::enableClocks();
+
+    // Pin to alternate function 2 (timers 3-5), fast output
+    GPIO_TypeDef *gpio = Pin::gpio();
+    gpio->AFR[Pin::BIT_NUMBER >> 3] = (gpio->AFR[Pin::BIT_NUMBER >> 3] & ~(0xF << ((Pin::BIT_NUMBER & 7) * 4))) | (2 << ((Pin::BIT_NUMBER & 7) * 4));
+    gpio->OSPEEDR |= (2 << (Pin::BIT_NUMBER * 2));
+    gpio->MODER = (gpio->MODER & ~(3 << (Pin::BIT_NUMBER * 2))) | (2 << (Pin::BIT_NUMBER * 2));
+
+    // One timer period per bit, pwm mode 1 with a preloaded compare value so each dma write lands on the next bit
+    TIM_TypeDef *tim = Pin::timer();
+    tim->CR1 = TIM_CR1_ARPE;
+    tim->PSC = 0;
+    tim->ARR = Encoder::PERIOD - 1;
+    compare() = Encoder::LATCH;
+    uint16_t ccmr = (TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE) << (((Pin::CHANNEL - 1) & 1) * 8);
+    if(Pin::CHANNEL <= 2) {
+      tim->CCMR1 = (tim->CCMR1 & ~(0xFF << (((Pin::CHANNEL - 1) & 1) * 8))) | ccmr;
+    } else {
+      tim->CCMR2 = (tim->CCMR2 & ~(0xFF << (((Pin::CHANNEL - 1) & 1) * 8))) | ccmr;
+    }
+    tim->CCER |= TIM_CCER_CC1E << ((Pin::CHANNEL - 1) * 4);
+    tim->EGR = TIM_EGR_UG;
+
+    attachInterruptDirect(Pin::irq(), &ClocklessDMAController::isr);
+  }
+
+  virtual void clearLeds(int nLeds) {
+    showColor(CRGB(0, 0, 0), nLeds, 0);
+  }
+
+  // mWait is marked once the latch has gone out, so this covers the whole of the previous frame
+  virtual bool ready() { return !mBusy && mWait.ready(); }
+
+protected:
+
+  // set all the leds on the controller to a given color
+  virtual void showColor(const struct CRGB & rgbdata, int nLeds, CRGB scale) {
+    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
+    showPixels(pixels);
+  }
+
+  virtual void show(const struct CRGB *rgbdata, int nLeds, CRGB scale) {
+    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
+    showPixels(pixels);
+  }
+
+  #ifdef SUPPORT_ARGB
+  virtual void show(const struct CARGB *rgbdata, int nLeds, CRGB scale) {
+    PixelController<RGB_ORDER> pixels(rgbdata, nLeds, scale, getDither(), getGammaTable());
+    showPixels(pixels);
+  }
+  #endif
+
+private:
+  volatile uint32_t & compare() { return (&Pin::timer()->CCR1)[Pin::CHANNEL - 1]; }
+
+  void showPixels(PixelController<RGB_ORDER> & pixels) {
+    // The interrupt reads the staging buffer, so the previous frame has to finish before it is overwritten
+    while(mBusy);
+    mWait.wait();
+
+    int nLeds = pixels.mLen;
+    if(!stage(pixels)) { return; }
+    start(nLeds);
+  }
+
+  // Scale and dither the frame into wire order, so the interrupt only has to encode bytes.
+  bool stage(PixelController<RGB_ORDER> & pixels) {
+    int size = pixels.mLen * 3;
+    if(size > mStagingSize) {
+      delete [] mStaging;
+      mStaging = new uint8_t[size];
+      mStagingSize = mStaging ? size : 0;
+      if(!mStaging) { return false; }
+    }
+
+    loadAndScaleFrame(pixels, mStaging);
+    return true;
+  }
+
+  void start(int nLeds) {
+    TIM_TypeDef *tim = Pin::timer();
+    DMA_Stream_TypeDef *stream = Pin::stream();
+
+    mNext = mStaging;
+    mPixelsLeft = nLeds;
+    mLatchHalves = 0;
+    refill(mRing);
+    refill(mRing + HALF_SIZE);
+
+    tim->CR1 &= ~TIM_CR1_CEN;
+    tim->CNT = 0;
+    compare() = Encoder::LATCH;
+    tim->EGR = TIM_EGR_UG;
+
+    stream->CR = 0;
+    while(stream->CR & DMA_SxCR_EN);
+    clearFlags();
+    stream->PAR = (uint32_t)&compare();
+    stream->M0AR = (uint32_t)mRing;
+    stream->NDTR = RING_SIZE;
+    stream->FCR = 0;
+    stream->CR = ((uint32_t)Pin::DMA_CHANNEL << 25) | DMA_SxCR_PL_1 | DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0 |
+                 DMA_SxCR_MINC | DMA_SxCR_CIRC | DMA_SxCR_DIR_0 | DMA_SxCR_HTIE | DMA_SxCR_TCIE;
+
+    mBusy = true;
+    stream->CR |= DMA_SxCR_EN;
+    tim->DIER |= TIM_DIER_UDE;
+    tim->CR1 |= TIM_CR1_CEN;
+  }
+
+  void stop() {
+    TIM_TypeDef *tim = Pin::timer();
+    tim->DIER &= ~TIM_DIER_UDE;
+    Pin::stream()->CR &= ~DMA_SxCR_EN;
+    tim->CR1 &= ~TIM_CR1_CEN;
+    compare() = Encoder::LATCH;
+    mWait.mark();
+    mBusy = false;
+  }
+
+  // Fill the half of the ring that just finished streaming.  Once the frame is out, the line is held low for a
+  // whole half before the transfer stops, which covers the latch time.
+  void refill(uint16_t *half) {
+    if(mPixelsLeft > 0) {
+      int n = mPixelsLeft < HALF_PIXELS ? mPixelsLeft : HALF_PIXELS;
+      half = Encoder::encode(mNext, n * 3, half);
+      mNext += n * 3;
+      mPixelsLeft -= n;
+      for(int i = n * 24; i < HALF_SIZE; i++) { *half++ = Encoder::LATCH; }
+    } else if(mLatchHalves < 2) {
+      for(int i = 0; i < HALF_SIZE; i++) { *half++ = Encoder::LATCH; }
+      mLatchHalves++;
+    } else {
+      stop();
+    }
+  }
+
+  static volatile uint32_t & flagRegister() { return Pin::STREAM_INDEX < 4 ? DMA1->LISR : DMA1->HISR; }
+  static volatile uint32_t & flagClearRegister() { return Pin::STREAM_INDEX < 4 ? DMA1->LIFCR : DMA1->HIFCR; }
+
+  static void clearFlags() { flagClearRegister() = 0x3D << FLAG_SHIFT; }
+
+  static void isr() {
+    uint32_t flags = flagRegister() >> FLAG_SHIFT;
+    clearFlags();
+
+    ClocklessDMAController *self = sActive;
+    if(!self || !self->mBusy) { return; }
+
+    // bit 4 is half transfer, bit 5 transfer complete
+    if(flags & 0x10) { self->refill(self->mRing); }
+    if((flags & 0x20) && self->mBusy) { self->refill(self->mRing + HALF_SIZE); }
+  }
+};
+
+template <int DATA_PIN, int T1, int T2, int T3, EOrder RGB_ORDER, int WAIT_TIME, int HALF_PIXELS>
+ClocklessDMAController<DATA_PIN, T1, T2, T3, RGB_ORDER, WAIT_TIME, HALF_PIXELS> *ClocklessDMAController<DATA_PIN, T1, T2, T3, RGB_ORDER, WAIT_TIME, HALF_PIXELS>::sActive = NULL;
+
+FASTLED_NAMESPACE_END
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __INC_CLOCKLESS_ENCODER_H
+#define __INC_CLOCKLESS_ENCODER_H
+
+#include <stdint.h>
+
+// This header has no hardware dependencies so the encoding can be exercised on a host
+#ifndef FASTLED_NAMESPACE_BEGIN
+#define FASTLED_NAMESPACE_BEGIN
+#define FASTLED_NAMESPACE_END
+#define FASTLED_USING_NAMESPACE
+#endif
+
+FASTLED_NAMESPACE_BEGIN
+
+/// Turns the T1/T2/T3 bit timings used by the clockless controllers (in cpu clocks) into compare values
+/// for a PWM timer that ticks once every CLOCKS_PER_TICK cpu clocks.  Every bit lasts T1+T2+T3; a 0 bit
+/// is high for T1 and a 1 bit is high for T1+T2.  Data is encoded msb first, one compare value per bit.
+template <int T1, int T2, int T3, int CLOCKS_PER_TICK>
+struct ClocklessTimerEncoder {
+  enum {
+    PERIOD = (T1 + T2 + T3 + CLOCKS_PER_TICK/2) / CLOCKS_PER_TICK,
+    ZERO_HIGH = (T1 + CLOCKS_PER_TICK/2) / CLOCKS_PER_TICK,
+    ONE_HIGH = (T1 + T2 + CLOCKS_PER_TICK/2) / CLOCKS_PER_TICK,
+    // compare value that keeps the line low for a whole bit, used for the latch
+    LATCH = 0
+  };
+
+  static_assert(ZERO_HIGH > 0 && ONE_HIGH > ZERO_HIGH && PERIOD > ONE_HIGH, "timer too coarse for these timings");
+  static_assert(ONE_HIGH < 256, "high time does not fit an 8 bit compare value");
+
+  /// Encode one byte as 8 compare values, returning the position after them.  T is the width of the
+  /// compare register the values are destined for.
+  template<typename T> static inline T *encodeByte(uint8_t b, T *out) {
+    for(int i = 0; i < 8; i++) {
+      *out++ = (b & 0x80) ? ONE_HIGH : ZERO_HIGH;
+      b <<= 1;
+    }
+    return out;
+  }
+
+  /// Encode nBytes bytes, returning the position after the last compare value.
+  template<typename T> static inline T *encode(const uint8_t *data, int nBytes, T *out) {
+    while(nBytes--) {
+      out = encodeByte(*data++, out);
+    }
+    return out;
+  }
+
+  /// Decode a compare value back to the bit it carries. Returns -1 for the latch value.
+  static inline int decodeBit(uint16_t compare) {
+    if(compare == LATCH) { return -1; }
+    return compare > (ZERO_HIGH + ONE_HIGH) / 2;
+  }
+};
+
+FASTLED_NAMESPACE_END
+
+#endif
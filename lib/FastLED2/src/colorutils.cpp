@@ -6,6 +6,7 @@
 #include <math.h>
 
 #include "FastLED.h"
+#include "lib8tion_x4.h"
 
 FASTLED_NAMESPACE_BEGIN
 
@@ -14,7 +15,21 @@ FASTLED_NAMESPACE_BEGIN
 void fill_solid( struct CRGB * leds, int numToFill,
                  const struct CRGB& color)
 {
-    for( int i = 0; i < numToFill; i++) {
+    // Four pixels are exactly three words, so once a pixel lands on a word
+    // boundary the rest can be stored a word at a time
+    int i = 0;
+    for( ; i < numToFill && ((uintptr_t)&leds[i] & 3); i++) {
+        leds[i] = color;
+    }
+
+    const CRGB pattern[4] = { color, color, color, color };
+    uint32_t words[3];
+    memcpy( words, pattern, sizeof(words));
+    for( ; i + 4 <= numToFill; i += 4) {
+        memcpy( &leds[i], words, sizeof(words));
+    }
+
+    for( ; i < numToFill; i++) {
         leds[i] = color;
     }
 }
@@ -172,9 +187,7 @@ void fill_gradient_RGB( CRGB* leds, uint16_t numLeds, const CRGB& c1, const CRGB
 
 void nscale8_video( CRGB* leds, uint16_t num_leds, uint8_t scale)
 {
-    for( uint16_t i = 0; i < num_leds; i++) {
-        leds[i].nscale8_video( scale);
-    }
+    nscale8_video_bytes( (uint8_t*)leds, num_leds * 3, scale);
 }
 
 void fade_video(CRGB* leds, uint16_t num_leds, uint8_t fadeBy)
@@ -205,9 +218,7 @@ void nscale8_raw( CRGB* leds, uint16_t num_leds, uint8_t scale)
 
 void nscale8( CRGB* leds, uint16_t num_leds, uint8_t scale)
 {
-    for( uint16_t i = 0; i < num_leds; i++) {
-        leds[i].nscale8( scale);
-    }
+    nscale8_bytes( (uint8_t*)leds, num_leds * 3, scale);
 }
 
 void fadeUsingColor( CRGB* leds, uint16_t numLeds, const CRGB& colormask)
@@ -18,8 +18,15 @@ FASTLED_NAMESPACE_BEGIN
 
 #define DISABLE_DITHER 0x00
 #define BINARY_DITHER 0x01
+// Work in 16 bits and carry what doesn't fit in the output byte over to the next frame, per led.  Only controllers
+// that scale a whole frame through loadAndScaleFrame support it; the rest treat it as DISABLE_DITHER.
+#define SIGMA_DELTA_DITHER 0x02
 typedef uint8_t EDitherMode;
 
+// Gamma tables map each byte value to 8.8 fixed point, so that dim values keep their fraction for the controllers
+// that can dither it out.  This one leaves values as they are, for controllers that haven't been given a gamma.
+extern const uint16_t LinearGammaTable[256];
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // LED Controller interface definition
@@ -40,6 +47,14 @@ protected:
     CRGB m_ColorTemperature;
     EDitherMode m_DitherMode;
     int m_nLeds;
+    // lookup built by setGamma, NULL while the gamma is 1
+    uint16_t *m_pGammaTable;
+    float m_Gamma;
+    // set when the last frame was quantised with a remainder that sending it again would work off
+    bool m_bDitherPending;
+    // what SIGMA_DELTA_DITHER carries over between frames, one byte per output byte
+    uint8_t *m_pResidue;
+    int m_nResidueSize;
     static CLEDController *m_pHead;
     static CLEDController *m_pTail;
 
@@ -54,8 +69,31 @@ protected:
     // as above, but every 4th uint8_t is assumed to be alpha channel data, and will be skipped
     virtual void show(const struct CARGB *data, int nLeds, CRGB scale) = 0;
 #endif
+
+    // Scale the rest of pixels into out, 3 bytes per pixel in output order, for controllers that encode a whole
+    // frame before sending it.  Does the sigma-delta dithering when that is on.
+    template<class PIXELS> uint8_t *loadAndScaleFrame(PIXELS & pixels, uint8_t *out) {
+        if(m_DitherMode == SIGMA_DELTA_DITHER) {
+            uint8_t *residue = sigmaDeltaResidue(pixels.mLen * 3);
+            if(residue) { return pixels.loadAndScaleAll(out, residue, m_bDitherPending); }
+        }
+        m_bDitherPending = false;
+        return pixels.loadAndScaleAll(out);
+    }
+
+    // Fresh residues are spread over the whole range (157 is odd, so i * 157 visits every byte value) so that
+    // neighbouring leds sharing a fraction don't all step up on the same frame
+    uint8_t *sigmaDeltaResidue(int size) {
+        if(size > m_nResidueSize) {
+            delete [] m_pResidue;
+            m_pResidue = new uint8_t[size];
+            m_nResidueSize = m_pResidue ? size : 0;
+            for(int i = 0; i < m_nResidueSize; i++) { m_pResidue[i] = i * 157; }
+        }
+        return m_pResidue;
+    }
 public:
-    CLEDController() : m_Data(NULL), m_ColorCorrection(UncorrectedColor), m_ColorTemperature(UncorrectedTemperature), m_DitherMode(BINARY_DITHER), m_nLeds(0) {
+    CLEDController() : m_Data(NULL), m_ColorCorrection(UncorrectedColor), m_ColorTemperature(UncorrectedTemperature), m_DitherMode(BINARY_DITHER), m_nLeds(0), m_pGammaTable(NULL), m_Gamma(1.0f), m_bDitherPending(false), m_pResidue(NULL), m_nResidueSize(0) {
         m_pNext = NULL;
         if(m_pHead==NULL) { m_pHead = this; }
         if(m_pTail != NULL) { m_pTail->m_pNext = this; }
@@ -68,6 +106,9 @@ public:
 	// clear out/zero out the given number of leds.
 	virtual void clearLeds(int nLeds) = 0;
 
+	// whether a show would start right away, rather than waiting on the previous frame or the latch time
+	virtual bool ready() { return true; }
+
     // show function w/integer brightness, will scale for color correction and temperature
     void show(const struct CRGB *data, int nLeds, uint8_t brightness) {
         show(data, nLeds, getAdjustment(brightness));
@@ -130,6 +171,16 @@ public:
     CLEDController & setTemperature(ColorTemperature temperature) { m_ColorTemperature = temperature; return *this; }
     CRGB getTemperature() { return m_ColorTemperature; }
 
+    // Gamma applied to every byte as it is loaded for output, ahead of dithering and scaling.  The table is built
+    // here, so changing it costs 256 pow() calls once and showing costs a lookup per byte.
+    CLEDController & setGamma(float gamma);
+    float getGamma() { return m_Gamma; }
+    const uint16_t *getGammaTable() { return m_pGammaTable ? m_pGammaTable : LinearGammaTable; }
+
+    // With SIGMA_DELTA_DITHER, whether the last frame left fractions behind, so the leds only average out to the
+    // right values if it is shown again
+    bool ditherPending() { return m_bDitherPending; }
+
     CRGB getAdjustment(uint8_t scale) {
 #if defined(NO_CORRECTION) && (NO_CORRECTION==1)
         return CRGB(scale,scale,scale);
@@ -164,6 +215,7 @@ struct PixelController {
         uint8_t e[3];
         CRGB mScale;
         uint8_t mAdvance;
+        const uint16_t *mGamma;
 
         PixelController(const PixelController & other) {
             d[0] = other.d[0];
@@ -176,33 +228,34 @@ struct PixelController {
             mScale = other.mScale;
             mAdvance = other.mAdvance;
             mLen = other.mLen;
+            mGamma = other.mGamma;
         }
 
-        PixelController(const uint8_t *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, bool advance=true, uint8_t skip=0) : mData(d), mLen(len), mScale(s) {
+        PixelController(const uint8_t *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, bool advance=true, uint8_t skip=0, const uint16_t *gamma = NULL) : mData(d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             mData += skip;
             mAdvance = (advance) ? 3+skip : 0;
         }
 
-        PixelController(const CRGB *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER) : mData((const uint8_t*)d), mLen(len), mScale(s) {
+        PixelController(const CRGB *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, const uint16_t *gamma = NULL) : mData((const uint8_t*)d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             mAdvance = 3;
         }
 
-        PixelController(const CRGB &d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER) : mData((const uint8_t*)&d), mLen(len), mScale(s) {
+        PixelController(const CRGB &d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, const uint16_t *gamma = NULL) : mData((const uint8_t*)&d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             mAdvance = 0;
         }
 
 #ifdef SUPPORT_ARGB
-        PixelController(const CARGB &d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER) : mData((const uint8_t*)&d), mLen(len), mScale(s) {
+        PixelController(const CARGB &d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, const uint16_t *gamma = NULL) : mData((const uint8_t*)&d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             // skip the A in CARGB
             mData += 1;
             mAdvance = 0;
         }
 
-        PixelController(const CARGB *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER) : mData((const uint8_t*)d), mLen(len), mScale(s) {
+        PixelController(const CARGB *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, const uint16_t *gamma = NULL) : mData((const uint8_t*)d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             // skip the A in CARGB
             mData += 1;
@@ -319,7 +372,8 @@ struct PixelController {
             d[RO(0)] = e[RO(0)] - d[RO(0)];
         }
 
-        template<int SLOT>  __attribute__((always_inline)) inline static uint8_t loadByte(PixelController & pc) { return pc.mData[RO(SLOT)]; }
+        template<int SLOT>  __attribute__((always_inline)) inline static uint8_t loadByte(PixelController & pc) { return (pc.mGamma[pc.mData[RO(SLOT)]] + 0x80) >> 8; }
+        template<int SLOT>  __attribute__((always_inline)) inline static uint16_t loadWord(PixelController & pc) { return pc.mGamma[pc.mData[RO(SLOT)]]; }
         template<int SLOT>  __attribute__((always_inline)) inline static uint8_t dither(PixelController & pc, uint8_t b) { return b ? qadd8(b, pc.d[RO(SLOT)]) : 0; }
         template<int SLOT>  __attribute__((always_inline)) inline static uint8_t scale(PixelController & pc, uint8_t b) { return scale8(b, pc.mScale.raw[RO(SLOT)]); }
 
@@ -333,6 +387,48 @@ struct PixelController {
 		__attribute__((always_inline)) inline uint8_t loadAndScale2() { return loadAndScale<2>(*this); }
 		__attribute__((always_inline)) inline uint8_t advanceAndLoadAndScale0() { return advanceAndLoadAndScale<0>(*this); }
     __attribute__((always_inline)) inline uint8_t stepAdvanceAndLoadAndScale0() { stepDithering(); return advanceAndLoadAndScale<0>(*this); }
+
+    // Scale and dither all the remaining pixels into out, 3 bytes per pixel in output order.  For controllers that
+    // encode a whole frame before they start sending it.
+    uint8_t *loadAndScaleAll(uint8_t *out) {
+        while(has(1)) {
+            stepDithering();
+            *out++ = loadAndScale<0>(*this);
+            *out++ = loadAndScale<1>(*this);
+            *out++ = loadAndScale<2>(*this);
+            advanceData();
+        }
+        return out;
+    }
+
+    // SIGMA_DELTA_DITHER version of the above.  Each byte is gamma corrected and scaled in 16 bits, and the low 8
+    // bits are left in residue, one byte per output byte, to be added back in on the next frame.  Over a few frames
+    // each led then averages out to its exact value, however dim.  Returns true in pending if any value had a
+    // fraction, so the frame has to keep being sent for the average to come out right.
+    uint8_t *loadAndScaleAll(uint8_t *out, uint8_t *residue, bool & pending) {
+        // scale by (s+1)/256 so that 255 is a no-op, keeping 0 as off
+        uint16_t k0 = mScale.raw[RO(0)], k1 = mScale.raw[RO(1)], k2 = mScale.raw[RO(2)];
+        k0 += (k0 != 0); k1 += (k1 != 0); k2 += (k2 != 0);
+        uint32_t fraction = 0;
+        while(has(1)) {
+            out = quantise(out, loadWord<0>(*this), k0, residue++, fraction);
+            out = quantise(out, loadWord<1>(*this), k1, residue++, fraction);
+            out = quantise(out, loadWord<2>(*this), k2, residue++, fraction);
+            advanceData();
+        }
+        pending = fraction != 0;
+        return out;
+    }
+
+    // w is at most 0xFF00, so w scaled plus a residue always fits 16 bits
+    __attribute__((always_inline)) inline static uint8_t *quantise(uint8_t *out, uint16_t w, uint16_t k, uint8_t *residue, uint32_t & fraction) {
+        uint16_t scaled = ((uint32_t)w * k) >> 8;
+        uint16_t v = scaled + *residue;
+        fraction |= scaled & 0xFF;
+        *residue = v & 0xFF;
+        *out++ = v >> 8;
+        return out;
+    }
 };
 
 // Pixel controller class.  This is the class that we use to centralize pixel access in a block of data, including
@@ -346,6 +442,7 @@ struct MultiPixelController {
         uint8_t e[3];
         CRGB mScale;
         int8_t mAdvance;
+        const uint16_t *mGamma;
         int mOffsets[LANES];
 
         MultiPixelController(const MultiPixelController & other) {
@@ -359,6 +456,7 @@ struct MultiPixelController {
             mScale = other.mScale;
             mAdvance = other.mAdvance;
             mLen = other.mLen;
+            mGamma = other.mGamma;
             for(int i = 0; i < LANES; i++) { mOffsets[i] = other.mOffsets[i]; }
 
         }
@@ -371,27 +469,27 @@ struct MultiPixelController {
           }
         }
 
-        MultiPixelController(const uint8_t *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, bool advance=true, uint8_t skip=0) : mData(d), mLen(len), mScale(s) {
+        MultiPixelController(const uint8_t *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, bool advance=true, uint8_t skip=0, const uint16_t *gamma = NULL) : mData(d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             mData += skip;
             mAdvance = (advance) ? 3+skip : 0;
             initOffsets(len);
         }
 
-        MultiPixelController(const CRGB *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER) : mData((const uint8_t*)d), mLen(len), mScale(s) {
+        MultiPixelController(const CRGB *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, const uint16_t *gamma = NULL) : mData((const uint8_t*)d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             mAdvance = 3;
             initOffsets(len);
         }
 
-        MultiPixelController(const CRGB &d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER) : mData((const uint8_t*)&d), mLen(len), mScale(s) {
+        MultiPixelController(const CRGB &d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, const uint16_t *gamma = NULL) : mData((const uint8_t*)&d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             mAdvance = 0;
             initOffsets(len);
         }
 
 #ifdef SUPPORT_ARGB
-        MultiPixelController(const CARGB &d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER) : mData((const uint8_t*)&d), mLen(len), mScale(s) {
+        MultiPixelController(const CARGB &d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, const uint16_t *gamma = NULL) : mData((const uint8_t*)&d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             // skip the A in CARGB
             mData += 1;
@@ -399,7 +497,7 @@ struct MultiPixelController {
             initOffsets(len);
         }
 
-        MultiPixelController(const CARGB *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER) : mData((const uint8_t*)d), mLen(len), mScale(s) {
+        MultiPixelController(const CARGB *d, int len, CRGB & s, EDitherMode dither = BINARY_DITHER, const uint16_t *gamma = NULL) : mData((const uint8_t*)d), mLen(len), mScale(s), mGamma(gamma ? gamma : LinearGammaTable) {
             enable_dithering(dither);
             // skip the A in CARGB
             mData += 1;
@@ -517,7 +615,7 @@ struct MultiPixelController {
             d[RO(0)] = e[RO(0)] - d[RO(0)];
         }
 
-        template<int SLOT>  __attribute__((always_inline)) inline static uint8_t loadByte(MultiPixelController & pc, int lane) { return pc.mData[pc.mOffsets[lane] + RO(SLOT)]; }
+        template<int SLOT>  __attribute__((always_inline)) inline static uint8_t loadByte(MultiPixelController & pc, int lane) { return (pc.mGamma[pc.mData[pc.mOffsets[lane] + RO(SLOT)]] + 0x80) >> 8; }
         template<int SLOT>  __attribute__((always_inline)) inline static uint8_t dither(MultiPixelController & pc, uint8_t b) { return b ? qadd8(b, pc.d[RO(SLOT)]) : 0; }
         template<int SLOT>  __attribute__((always_inline)) inline static uint8_t dither(MultiPixelController & pc, uint8_t b, uint8_t d) { return b ? qadd8(b,d) : 0; }
         template<int SLOT>  __attribute__((always_inline)) inline static uint8_t scale(MultiPixelController & pc, uint8_t b) { return scale8(b, pc.mScale.raw[RO(SLOT)]); }
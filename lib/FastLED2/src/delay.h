@@ -17,6 +17,9 @@ public:
 		} while(diff < WAIT);
 	}
 
+	// true once wait() would return straight away
+	bool ready() { return (uint16_t)((micros() & 0xFFFF) - mLastMicros) >= WAIT; }
+
 	void mark() { mLastMicros = micros() & 0xFFFF; }
 };
 
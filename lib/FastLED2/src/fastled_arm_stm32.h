@@ -6,5 +6,9 @@
 #include "fastpin_arm_stm32.h"
 // #include "fastspi_arm_stm32.h"
 #include "clockless_arm_stm32.h"
+#if defined(STM32F2XX)
+#include "clockless_dma_arm_stm32.h"
+#include "clockless_block_arm_stm32.h"
+#endif
 
 #endif
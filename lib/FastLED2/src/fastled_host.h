@@ -0,0 +1,7 @@
+#ifndef __INC_FASTLED_HOST_H
+#define __INC_FASTLED_HOST_H
+
+// No output hardware on the host; controllers come from the program using the library
+#include "delay.h"
+
+#endif
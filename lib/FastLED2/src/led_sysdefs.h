@@ -14,6 +14,8 @@
 #include "platforms/arm/sam/led_sysdefs_arm_sam.h"
 #elif defined(STM32F10X_MD) || defined(STM32F2XX)
 #include "led_sysdefs_arm_stm32.h"
+#elif defined(FASTLED_HOST)
+#include "led_sysdefs_host.h"
 #else
 // AVR platforms
 #include "platforms/avr/led_sysdefs_avr.h"
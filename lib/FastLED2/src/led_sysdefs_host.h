@@ -0,0 +1,58 @@
+#ifndef __INC_LED_SYSDEFS_HOST_H
+#define __INC_LED_SYSDEFS_HOST_H
+
+// Host (desktop) build, for running the colour maths, controllers and encoders in tests and benchmarks.  There is
+// no hardware: the program linking the library supplies micros(), millis() and delay(), usually from a simulated
+// clock, and adds a controller of its own to capture what would have been sent.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define FASTLED_NAMESPACE_BEGIN namespace NSFastLED {
+#define FASTLED_NAMESPACE_END }
+#define FASTLED_USING_NAMESPACE using namespace NSFastLED;
+
+#define FASTLED_HOST_BUILD
+
+#ifndef INTERRUPT_THRESHOLD
+#define INTERRUPT_THRESHOLD 1
+#endif
+
+#ifndef FASTLED_ALLOW_INTERRUPTS
+#define FASTLED_ALLOW_INTERRUPTS 1
+#endif
+
+#define cli()
+#define sei()
+
+// pgmspace definitions
+#define PROGMEM
+#define pgm_read_dword(addr) (*(const unsigned long *)(addr))
+#define pgm_read_dword_near(addr) pgm_read_dword(addr)
+
+// data type defs
+typedef volatile       uint8_t RoRg; /**< Read only 8-bit register (volatile const unsigned int) */
+typedef volatile       uint8_t RwRg; /**< Read-Write 8-bit register (volatile unsigned int) */
+
+#define FASTLED_NO_PINMAP
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define INPUT 0
+#define OUTPUT 1
+#define LOW 0
+#define HIGH 1
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t value) {}
+
+// Provided by the program
+uint32_t micros();
+uint32_t millis();
+void delay(unsigned long ms);
+
+// Cycle counts are worked out for the photon
+#define F_CPU 120000000
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef __INC_LIB8TION_X4_H
+#define __INC_LIB8TION_X4_H
+
+#include "lib8tion.h"
+
+FASTLED_NAMESPACE_BEGIN
+
+///@defgroup Packed Packed byte math
+/// lib8tion operations on four bytes packed into a 32 bit word.  Results are bit for bit the same as calling
+/// the single byte function on each byte.  The Cortex-M3 in the photon has no SIMD instructions, so these work
+/// SIMD-within-a-register: lanes are kept apart with masks so one multiply handles several bytes.
+///@{
+
+/// scale8 on each byte of w.  Even and odd bytes are multiplied separately so each product has a 16 bit lane.
+LIB8STATIC uint32_t scale8x4( uint32_t w, fract8 scale)
+{
+    uint32_t even = w & 0x00FF00FF;
+    uint32_t odd = (w >> 8) & 0x00FF00FF;
+    even = ((even * scale) >> 8) & 0x00FF00FF;
+    odd = (odd * scale) & 0xFF00FF00;
+    return even | odd;
+}
+
+/// scale8_video on each byte of w: like scale8, but a nonzero byte never scales to zero unless scale is zero.
+LIB8STATIC uint32_t scale8x4_video( uint32_t w, fract8 scale)
+{
+    if( scale == 0) return 0;
+    // 0x01 in every lane whose byte is nonzero
+    uint32_t nonzero = ((w | ((w & 0x7F7F7F7F) + 0x7F7F7F7F)) >> 7) & 0x01010101;
+    return scale8x4( w, scale) + nonzero;
+}
+
+/// Scale count bytes in place with scale8, four at a time where the buffer is word aligned.
+LIB8STATIC void nscale8_bytes( uint8_t* p, uint32_t count, fract8 scale)
+{
+    while( count && ((uintptr_t)p & 3)) { *p = scale8( *p, scale); p++; count--; }
+    for( ; count >= 4; count -= 4, p += 4) {
+        uint32_t w;
+        memcpy( &w, p, 4);
+        w = scale8x4( w, scale);
+        memcpy( p, &w, 4);
+    }
+    while( count--) { *p = scale8( *p, scale); p++; }
+}
+
+/// Scale count bytes in place with scale8_video, four at a time where the buffer is word aligned.
+LIB8STATIC void nscale8_video_bytes( uint8_t* p, uint32_t count, fract8 scale)
+{
+    while( count && ((uintptr_t)p & 3)) { *p = scale8_video( *p, scale); p++; count--; }
+    for( ; count >= 4; count -= 4, p += 4) {
+        uint32_t w;
+        memcpy( &w, p, 4);
+        w = scale8x4_video( w, scale);
+        memcpy( p, &w, 4);
+    }
+    while( count--) { *p = scale8_video( *p, scale); p++; }
+}
+
+///@}
+
+FASTLED_NAMESPACE_END
+
+#endif
@@ -65,13 +65,39 @@ uint32_t calculate_unscaled_power_mW( const CRGB* ledbuffer, uint16_t numLeds )
         count--;
     }
 
-    red32   *= gRed_mW;
-    green32 *= gGreen_mW;
-    blue32  *= gBlue_mW;
+    const uint32_t sums[3] = { red32, green32, blue32 };
+    return calculate_power_from_sums_mW( sums, numLeds);
+}
+
+uint32_t calculate_lit_power_mW( const CRGB* ledbuffer, uint16_t numLeds, const uint16_t *gamma )
+{
+    // Summed in the table's 8.8 fixed point, so the fractions the dithering
+    // carries into later frames count too
+    uint32_t red32 = 0, green32 = 0, blue32 = 0;
+    const uint8_t* p = (const uint8_t*)ledbuffer;
 
-    red32   >>= 8;
-    green32 >>= 8;
-    blue32  >>= 8;
+    uint16_t count = numLeds;
+    while( count) {
+        red32   += gamma[*p++];
+        green32 += gamma[*p++];
+        blue32  += gamma[*p++];
+        count--;
+    }
+
+    const uint32_t sums[3] = { red32 >> 8, green32 >> 8, blue32 >> 8 };
+    return calculate_power_from_sums_mW( sums, 0);
+}
+
+uint32_t calculate_dark_power_mW( uint16_t numLeds)
+{
+    return gDark_mW * numLeds;
+}
+
+uint32_t calculate_power_from_sums_mW( const uint32_t sums[3], uint16_t numLeds)
+{
+    uint32_t red32   = (sums[0] * gRed_mW) >> 8;
+    uint32_t green32 = (sums[1] * gGreen_mW) >> 8;
+    uint32_t blue32  = (sums[2] * gBlue_mW) >> 8;
 
     uint32_t total = red32 + green32 + blue32 + (gDark_mW * numLeds);
 
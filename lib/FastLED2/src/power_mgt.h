@@ -43,6 +43,17 @@ void delay_at_max_brightness_for_power( uint16_t ms);
 //   target_brightess you supply, but may be lower.
 uint32_t calculate_unscaled_power_mW( const CRGB* ledbuffer, uint16_t numLeds);
 
+// calculate_lit_power_mW tells you how many milliwatts the LED data, as a
+//   controller using the gamma table would send it, draws at brightness = 255
+//   over calculate_dark_power_mW, what the leds take whatever they show.
+//   Only the first part scales with brightness.
+uint32_t calculate_lit_power_mW( const CRGB* ledbuffer, uint16_t numLeds, const uint16_t *gamma);
+uint32_t calculate_dark_power_mW( uint16_t numLeds);
+
+// calculate_power_from_sums_mW does the same from red, green and blue
+//   already summed over numLeds leds.
+uint32_t calculate_power_from_sums_mW( const uint32_t sums[3], uint16_t numLeds);
+
 uint8_t  calculate_max_brightness_for_power_mW( uint8_t target_brightness, uint32_t max_power_mW);
 
 FASTLED_NAMESPACE_END
@@ -3,17 +3,28 @@
 #include "papertrail.h"
 #include "secrets.h"
 #include "light.h"
+#include "photon_platform.h"
+#include "topic_router.h"
+#include "state_publisher.h"
+#include "telemetry.h"
+#include "perf_counters.h"
 #include "DiagnosticsHelperRK.h"
 
+#ifndef MQTT_TOPIC_PREFIX
+#define MQTT_TOPIC_PREFIX "home/light/playroom/skylight"
+#endif
+
+// Largest telemetry message; measurements that don't fit go in the next one
+#define METRICS_BUFFER_SIZE 512
+
+// Longest string a Particle.variable can return
+#define PERF_JSON_SIZE 622
+
 // Stubs
 void mqttCallback(char* topic, byte* payload, unsigned int length);
-void publishPowerState();
-void publishMode();
-void publishColor();
-void publishBrightness();
 
-Light light;
-unsigned long nextRGBPublish;
+PhotonPlatform photonPlatform;
+Light light(photonPlatform);
 
 uint32_t resetTime = 0;
 retained uint32_t lastHardResetTime;
@@ -28,133 +39,96 @@ unsigned int mqttConnectionAttempts;
 unsigned int udpLocalPort = 8888;
 UDP Udp;
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  char p[length + 1];
-  memcpy(p, payload, length);
-  p[length] = '\0';
-
-  Log.info("%s - %s", topic, p);
-  if (strcmp(topic, "home/light/playroom/skylight/switch/set") == 0) {
-    bool publishState = false;
-    if (strcmp(p, "ON") == 0 && !light.isOn()) {
-      light.on();
-      publishState = true;
-    } else if (strcmp(p, "OFF") == 0 && light.isOn()) {
-      light.off();
-      publishState = true;
-    }
-
-    if (publishState && mqttClient.isConnected()) {
-      publishPowerState();
-      publishBrightness();
-    }
-  } else if (strcmp(topic, "home/light/playroom/skylight/rgb/set") == 0) {
-    int r, g, b = 0;
-    char *a;
-    a = strtok(p, ",");
-    r = atoi(a);
-    a = strtok(NULL, ",");
-    g = atoi(a);
-    a = strtok(NULL, ",");
-    b = atoi(a);
-    light.setColor(r, g, b);
-    light.setMode(Light::STATIC);
-    publishMode();
-    publishColor();
-  } else if (strcmp(topic, "home/light/playroom/skylight/effect/set") == 0) {
-    if (strcmp(p, "static") == 0)
-      light.setMode(Light::STATIC);
-    else if (strcmp(p, "rainbow") == 0)
-      light.setMode(Light::RAINBOW);
-    else if (strcmp(p, "christmas") == 0)
-      light.setMode(Light::CHRISTMAS);
-    else if (strcmp(p, "meteors") == 0)
-      light.setMode(Light::METEORS);
-    else if (strcmp(p, "light_swipe") == 0)
-      light.setMode(Light::LIGHT_SWIPE);
-    else if (strcmp(p, "bounce") == 0)
-      light.setMode(Light::BOUNCE);
-    publishMode();
-  } else if (strcmp(topic, "home/light/playroom/skylight/brightness/set") == 0) {
-    char b = atoi(p);
-    light.setBrightness(b);
-    mqttClient.publish("home/light/playroom/skylight/brightness", p, true);
-    publishBrightness();
+// Neither changes while connected, so they're formatted once rather than
+// building Strings every report
+char firmwareVersion[16];
+char ipAddress[16];
+
+TopicRouter commandRouter(MQTT_TOPIC_PREFIX);
+StatePublisher statePublisher(light, mqttClient, commandRouter);
+
+void onSwitchSet(const char *topic, char *p, unsigned int length) {
+  bool changed = false;
+  if (strcmp(p, "ON") == 0 && !light.isOn()) {
+    light.on();
+    changed = true;
+  } else if (strcmp(p, "OFF") == 0 && light.isOn()) {
+    light.off();
+    changed = true;
   }
 
-  light.saveSettings();
+  if (changed)
+    statePublisher.markDirty(StatePublisher::POWER | StatePublisher::BRIGHTNESS);
 }
 
-void connectToMQTT() {
-  lastMqttConnectAttempt = millis();
-  bool mqttConnected = mqttClient.connect(System.deviceID(), mqttUsername, mqttPassword);
-  if (mqttConnected) {
-    mqttConnectionAttempts = 0;
-    Log.info("MQTT Connected");
-    mqttClient.subscribe("home/light/playroom/skylight/+/set");
-    publishPowerState();
-    publishMode();
-    publishColor();
-    publishBrightness();
-  } else {
-    mqttConnectionAttempts++;
-    Log.info("MQTT failed to connect");
-  }
+void onRgbSet(const char *topic, char *p, unsigned int length) {
+  int r, g, b = 0;
+  char *a;
+  a = strtok(p, ",");
+  r = atoi(a);
+  a = strtok(NULL, ",");
+  g = atoi(a);
+  a = strtok(NULL, ",");
+  b = atoi(a);
+  light.setColor(r, g, b);
+  light.setMode(Light::STATIC);
+  statePublisher.markDirty(StatePublisher::MODE | StatePublisher::COLOR);
 }
 
-uint32_t nextMetricsUpdate = 0;
-void sendTelegrafMetrics() {
-    if (millis() > nextMetricsUpdate) {
-        nextMetricsUpdate = millis() + 30000;
+void onEffectSet(const char *topic, char *p, unsigned int length) {
+  uint8_t mode = effectMode(p);
+  if (mode != Light::NONE)
+    light.setMode((Light::MODES)mode);
+  statePublisher.markDirty(StatePublisher::MODE);
+}
 
-        char buffer[150];
-        snprintf(buffer, sizeof(buffer),
-            "status,device=Skylight uptime=%d,resetReason=%d,firmware=\"%s\",memTotal=%ld,memUsed=%ld,ipv4=\"%s\"",
-            System.uptime(),
-            System.resetReason(),
-            System.version().c_str(),
-            DiagnosticsHelper::getValue(DIAG_ID_SYSTEM_TOTAL_RAM),
-            DiagnosticsHelper::getValue(DIAG_ID_SYSTEM_USED_RAM),
-            WiFi.localIP().toString().c_str()
-            );
-        mqttClient.publish("telegraf/particle", buffer);
-    }
+void onBrightnessSet(const char *topic, char *p, unsigned int length) {
+  char b = atoi(p);
+  light.setBrightness(b);
+  statePublisher.markDirty(StatePublisher::BRIGHTNESS);
 }
 
-void publishPowerState() {
-  mqttClient.publish("home/light/playroom/skylight/switch", light.isOn() ? "ON" : "OFF", true);
+// Share of the CPU frames may take; the rest is left to MQTT and the cloud
+void onCpuBudgetSet(const char *topic, char *p, unsigned int length) {
+  light.setCpuBudget(atoi(p));
 }
 
-void publishMode() {
-  if (light.getMode() == Light::STATIC)
-    mqttClient.publish("home/light/playroom/skylight/effect", "static", true);
-  else if (light.getMode() == Light::RAINBOW)
-    mqttClient.publish("home/light/playroom/skylight/effect", "rainbow", true);
-  else if (light.getMode() == Light::CHRISTMAS)
-    mqttClient.publish("home/light/playroom/skylight/effect", "christmas", true);
-  else if (light.getMode() == Light::METEORS)
-    mqttClient.publish("home/light/playroom/skylight/effect", "meteors", true);
-  else if (light.getMode() == Light::LIGHT_SWIPE)
-    mqttClient.publish("home/light/playroom/skylight/effect", "light_swipe", true);
-  else if (light.getMode() == Light::BOUNCE)
-    mqttClient.publish("home/light/playroom/skylight/effect", "bounce", true);
+// Relative to the device prefix
+static const TopicRoute commandRoutes[] = {
+  { "switch/set",     onSwitchSet },
+  { "rgb/set",        onRgbSet },
+  { "effect/set",     onEffectSet },
+  { "brightness/set", onBrightnessSet },
+  { "cpubudget/set",  onCpuBudgetSet },
+};
+
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  char p[length + 1];
+  memcpy(p, payload, length);
+  p[length] = '\0';
+
+  Log.info("%s - %s", topic, p);
+  commandRouter.dispatch(topic, p, length);
+
+  light.saveSettings();
 }
 
-void publishColor() {
-  char rgbString[12];
-  uint32_t c = light.getColor();
-  uint8_t
-    r = (uint8_t)(c >> 16),
-    g = (uint8_t)(c >>  8),
-    b = (uint8_t)c;
-  sprintf(rgbString, "%d,%d,%d", r, g, b);
-  mqttClient.publish("home/light/playroom/skylight/rgb", rgbString, true);
+void mqttConnected() {
+  mqttConnectionAttempts = 0;
+  IPAddress ip = WiFi.localIP();
+  snprintf(ipAddress, sizeof(ipAddress), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  Log.info("MQTT Connected");
+  char topic[TOPIC_ROUTER_MAX_PREFIX + 8];
+  if (commandRouter.topic(topic, sizeof(topic), "+/set"))
+    mqttClient.subscribe(topic);
+  statePublisher.markDirty(StatePublisher::ALL);
 }
 
-void publishBrightness() {
-  char b[4];
-  sprintf(b, "%d", light.getBrightness());
-  mqttClient.publish("home/light/playroom/skylight/brightness", b, true);
+void connectToMQTT() {
+  lastMqttConnectAttempt = millis();
+  mqttConnectionAttempts++;
+  if (!mqttClient.connect(System.deviceID(), mqttUsername, mqttPassword))
+    Log.info("MQTT failed to connect");
 }
 
 void random_seed_from_cloud(unsigned seed) {
@@ -169,6 +143,93 @@ PapertrailLogHandler papertrailHandler(papertrailAddress, papertrailPort,
   // TOO MUCH!!! { “comm”, LOG_LEVEL_ALL }
 });
 
+void statusMetrics(LineProtocol &line) {
+  line.measurement("status");
+  line.tag("device", "Skylight");
+  line.fieldUInt("uptime", System.uptime());
+  line.fieldInt("resetReason", System.resetReason());
+  line.fieldString("firmware", firmwareVersion);
+  line.fieldInt("memTotal", DiagnosticsHelper::getValue(DIAG_ID_SYSTEM_TOTAL_RAM));
+  line.fieldInt("memUsed", DiagnosticsHelper::getValue(DIAG_ID_SYSTEM_USED_RAM));
+  line.fieldString("ipv4", ipAddress);
+}
+
+void lightMetrics(LineProtocol &line) {
+  const FrameScheduler &scheduler = light.getScheduler();
+  line.measurement("light");
+  line.tag("device", "Skylight");
+  line.fieldUInt("mode", light.getMode());
+  line.fieldBool("on", light.isOn());
+  line.fieldUInt("brightness", light.getBrightness());
+  line.fieldUInt("renderAvg", scheduler.getAverageRender());
+  line.fieldUInt("renderMax", scheduler.getMaxRender());
+  line.fieldUInt("showAvg", scheduler.getAverageShow());
+  line.fieldUInt("showMax", scheduler.getMaxShow());
+  line.fieldUInt("showInterval", scheduler.getShowInterval());
+  line.fieldUInt("cpuBudget", scheduler.getCpuBudget());
+  static const char *missFields[FRAME_MISS_BUCKETS] = {
+    "missed1", "missed2", "missed4", "missed8", "missed16", "missed32"
+  };
+  for (uint8_t i = 0; i < FRAME_MISS_BUCKETS; i++)
+    line.fieldUInt(missFields[i], scheduler.getMisses(i));
+}
+
+void powerMetrics(LineProtocol &line) {
+  const PowerLimiter &power = light.getPowerLimiter();
+  line.measurement("power");
+  line.tag("device", "Skylight");
+  line.fieldUInt("mW", power.getPower());
+  line.fieldUInt("avgMw", power.getAveragePower());
+  line.fieldUInt("maxMw", power.getMaxPower());
+  line.fieldUInt("budgetMw", power.getBudget());
+  line.fieldUInt("ceiling", power.getCeiling());
+  line.fieldBool("throttling", power.isThrottling());
+  line.fieldUInt("throttleEvents", power.getThrottleEvents());
+}
+
+void mqttMetrics(LineProtocol &line) {
+  line.measurement("mqtt");
+  line.tag("device", "Skylight");
+  line.fieldUInt("connects", mqttClient.getConnectCount());
+  line.fieldUInt("publishes", mqttClient.getPublishCount());
+  line.fieldUInt("bytesCopied", mqttClient.getBytesCopied());
+  line.fieldUInt("queued", mqttClient.getQueuedBytes());
+}
+
+void logMetrics(LineProtocol &line) {
+  line.measurement("log");
+  line.tag("device", "Skylight");
+  line.fieldUInt("dropped", papertrailHandler.droppedLines());
+  line.fieldUInt("pending", papertrailHandler.pendingLines());
+}
+
+TelemetryRegistry telemetry;
+char metricsBuffer[METRICS_BUFFER_SIZE];
+
+// Performance counters for the last report interval
+char perfJson[PERF_JSON_SIZE] = "{}";
+
+uint32_t nextMetricsUpdate = 0;
+void sendTelegrafMetrics() {
+    if (millis() > nextMetricsUpdate) {
+        nextMetricsUpdate = millis() + 30000;
+
+        LineProtocol line(metricsBuffer, sizeof(metricsBuffer));
+        uint8_t next = 0;
+        while (next < telemetry.size()) {
+            line.clear();
+            next = telemetry.collect(line, next);
+            if (line.lines() > 0)
+                mqttClient.publish("telegraf/particle", line.c_str());
+        }
+
+        // Counters, peaks and misses cover one report interval each
+        perfToJson(perfJson, sizeof(perfJson));
+        perfReset();
+        light.resetFrameStats();
+    }
+}
+
 SYSTEM_THREAD(ENABLED)
 
 void startupMacro() {
@@ -185,7 +246,10 @@ void setup() {
     light.loadSettings();
     light.setup();
 
+    perfBegin();
+
     Particle.variable("resetTime", resetTime);
+    Particle.variable("perf", perfJson);
     Particle.publishVitals(900);
 
     waitFor(Particle.connected, 30000);
@@ -215,6 +279,17 @@ void setup() {
 
     Udp.begin(udpLocalPort);
 
+    strncpy(firmwareVersion, System.version().c_str(), sizeof(firmwareVersion) - 1);
+    telemetry.add(statusMetrics);
+    telemetry.add(lightMetrics);
+    telemetry.add(powerMetrics);
+    telemetry.add(mqttMetrics);
+    telemetry.add(logMetrics);
+    perfAddMetrics(telemetry);
+
+    commandRouter.add(commandRoutes, sizeof(commandRoutes) / sizeof(commandRoutes[0]));
+    mqttClient.addConnectCallback(mqttConnected);
+
     Log.info("Boot complete. Reset count = %d", resetCount);
 
     connectToMQTT();
@@ -224,21 +299,21 @@ void loop() {
 
   light.loop();
 
-  if (millis() > nextRGBPublish && !light.isColorPublished()) {
-    nextRGBPublish = millis() + 500;
-    publishColor();
-  }
-  
-  if (mqttClient.isConnected())
+  if (mqttClient.isConnected() || mqttClient.isConnecting())
   {
     mqttClient.loop();
-    sendTelegrafMetrics();
+    if (mqttClient.isConnected()) {
+      statePublisher.loop(millis());
+      sendTelegrafMetrics();
+    }
   }
   else if ((mqttConnectionAttempts < 5 && millis() > (lastMqttConnectAttempt + mqttConnectAttemptTimeout1)) ||
               millis() > (lastMqttConnectAttempt + mqttConnectAttemptTimeout2))
   {
     connectToMQTT();
   }
+
+  papertrailHandler.loop();
 /*
   if (Udp.parsePacket() > 0) {
 
@@ -0,0 +1,22 @@
+#include "animation_clock.h"
+
+void AnimationClock::start(uint32_t now) {
+  last = now;
+}
+
+uint32_t AnimationClock::advance(uint32_t now) {
+  uint32_t dt = now - last;
+  last = now;
+  if (dt > ANIMATION_MAX_CATCH_UP)
+    dt = ANIMATION_MAX_CATCH_UP;
+
+  elapsed += dt;
+  return dt;
+}
+
+uint16_t StepCounter::advance(uint32_t dt) {
+  carry += dt;
+  uint16_t steps = carry / ANIMATION_STEP_US;
+  carry -= steps * ANIMATION_STEP_US;
+  return steps;
+}
@@ -0,0 +1,41 @@
+#ifndef __ANIMATION_CLOCK_H_
+#define __ANIMATION_CLOCK_H_
+
+#include <stdint.h>
+
+// Length of one fixed animation step, and the most animation time a single
+// render may catch up on after a stall
+#define ANIMATION_STEP_US 10000
+#define ANIMATION_MAX_CATCH_UP 1000000
+
+/// Monotonic microsecond clock that animations run on. Light advances it by
+/// the real time between renders, so an animation keeps its speed however
+/// often it is rendered or shown. A stall longer than ANIMATION_MAX_CATCH_UP
+/// skips ahead rather than replaying all of it in one frame.
+class AnimationClock {
+public:
+  void start(uint32_t now);
+
+  /// Move to the real time now, returning how far animation time moved.
+  uint32_t advance(uint32_t now);
+
+  /// Animation time in microseconds. Wraps after about 71 minutes, so
+  /// compare times by subtracting them.
+  uint32_t time() const { return elapsed; }
+
+private:
+  uint32_t last = 0;
+  uint32_t elapsed = 0;
+};
+
+/// Turns elapsed animation time into whole fixed steps, carrying the part
+/// of a step left over to the next call.
+class StepCounter {
+public:
+  uint16_t advance(uint32_t dt);
+
+private:
+  uint32_t carry = 0;
+};
+
+#endif
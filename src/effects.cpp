@@ -0,0 +1,474 @@
+#include <new>
+#include "light.h"
+
+template<class T> static Effect *constructEffect(EffectArena &arena) {
+  return new (arena.data) T();
+}
+
+typedef Effect *(*EffectFactory)(EffectArena &arena);
+
+struct EffectEntry {
+  const char *name;
+  EffectFactory factory;
+};
+
+// Indexed by Light::MODES
+static const EffectEntry effectRegistry[] = {
+  { NULL,          NULL },                               // NONE
+  { "static",      constructEffect<StaticEffect<LightLayout> > },      // STATIC
+  { "rainbow",     constructEffect<RainbowEffect<LightLayout> > },     // RAINBOW
+  { "christmas",   constructEffect<ChristmasEffect<LightLayout> > },   // CHRISTMAS
+  { "meteors",     constructEffect<MeteorsEffect<LightLayout> > },     // METEORS
+  { "light_swipe", constructEffect<LightSwipeEffect<LightLayout> > },  // LIGHT_SWIPE
+  { "bounce",      constructEffect<BounceEffect<LightLayout> > },      // BOUNCE
+};
+
+#define EFFECT_REGISTRY_SIZE (sizeof(effectRegistry) / sizeof(effectRegistry[0]))
+
+static_assert(EFFECT_REGISTRY_SIZE == Light::BOUNCE + 1,
+              "effectRegistry must have an entry for every mode");
+
+Effect *createEffect(uint8_t mode, EffectArena &arena) {
+  if (mode >= EFFECT_REGISTRY_SIZE || !effectRegistry[mode].factory)
+    return NULL;
+
+  return effectRegistry[mode].factory(arena);
+}
+
+const char *effectName(uint8_t mode) {
+  if (mode >= EFFECT_REGISTRY_SIZE)
+    return NULL;
+
+  return effectRegistry[mode].name;
+}
+
+uint8_t effectMode(const char *name) {
+  for (uint8_t mode = 0; mode < EFFECT_REGISTRY_SIZE; mode++) {
+    if (effectRegistry[mode].name && strcmp(effectRegistry[mode].name, name) == 0)
+      return mode;
+  }
+  return Light::NONE;
+}
+
+bool Effect::renderFrame(Light &light, uint32_t dt) {
+  bool changed = false;
+  for (uint16_t n = steps.advance(dt); n > 0; n--)
+    changed = advance(light) || changed;
+  return changed;
+}
+
+template<class Layout>
+bool StaticEffect<Layout>::advance(Light &light) {
+  CRGB *leds = light.getLeds();
+  CRGB targetColor = light.getTargetColor();
+  bool changesMade = false;
+
+  for (int i = 0; i < 3; i++) {
+    if (leds[0][i] != targetColor[i]) {
+      changesMade = true;
+      if (targetColor[i] > leds[0][i]) {
+        leds[0][i] = targetColor[i]-leds[0][i] > 5 ? leds[0][i]+5 : targetColor[i];
+      } else {
+        leds[0][i] = leds[0][i]-targetColor[i] > 5 ? leds[0][i]-5 : targetColor[i];
+      }
+    }
+  }
+
+  if (changesMade)
+    fill_solid(leds, Layout::LENGTH, leds[0]);
+
+  return changesMade;
+}
+
+// Every hue fill_rainbow() can produce, hsv2rgb_rainbow(CHSV(hue, 240, 255))
+// worked out ahead of time. Plain bytes so the table stays in flash.
+static const uint8_t rainbowRamp[256][3] = {
+  {0xF0,0x00,0x00}, {0xEE,0x02,0x00}, {0xEB,0x05,0x00}, {0xE9,0x07,0x00}, {0xE6,0x0A,0x00}, {0xE3,0x0D,0x00},
+  {0xE2,0x0F,0x00}, {0xDF,0x11,0x00}, {0xDC,0x14,0x00}, {0xDA,0x16,0x00}, {0xD7,0x19,0x00}, {0xD4,0x1C,0x00},
+  {0xD3,0x1E,0x00}, {0xD0,0x20,0x00}, {0xCD,0x23,0x00}, {0xCB,0x25,0x00}, {0xC8,0x28,0x00}, {0xC5,0x2B,0x00},
+  {0xC4,0x2D,0x00}, {0xC1,0x2F,0x00}, {0xBE,0x32,0x00}, {0xBC,0x34,0x00}, {0xB9,0x37,0x00}, {0xB6,0x3A,0x00},
+  {0xB5,0x3C,0x00}, {0xB2,0x3E,0x00}, {0xAF,0x41,0x00}, {0xAD,0x43,0x00}, {0xAA,0x46,0x00}, {0xA7,0x49,0x00},
+  {0xA6,0x4B,0x00}, {0xA3,0x4D,0x00}, {0xA1,0x50,0x00}, {0xA1,0x52,0x00}, {0xA1,0x55,0x00}, {0xA1,0x57,0x00},
+  {0xA1,0x5A,0x00}, {0xA1,0x5C,0x00}, {0xA1,0x5E,0x00}, {0xA1,0x61,0x00}, {0xA1,0x64,0x00}, {0xA1,0x66,0x00},
+  {0xA1,0x69,0x00}, {0xA1,0x6B,0x00}, {0xA1,0x6D,0x00}, {0xA1,0x70,0x00}, {0xA1,0x73,0x00}, {0xA1,0x75,0x00},
+  {0xA1,0x78,0x00}, {0xA1,0x7A,0x00}, {0xA1,0x7C,0x00}, {0xA1,0x7F,0x00}, {0xA1,0x82,0x00}, {0xA1,0x84,0x00},
+  {0xA1,0x87,0x00}, {0xA1,0x89,0x00}, {0xA1,0x8B,0x00}, {0xA1,0x8E,0x00}, {0xA1,0x91,0x00}, {0xA1,0x93,0x00},
+  {0xA1,0x96,0x00}, {0xA1,0x98,0x00}, {0xA1,0x9A,0x00}, {0xA1,0x9D,0x00}, {0xA1,0xA1,0x00}, {0x9C,0xA3,0x00},
+  {0x97,0xA6,0x00}, {0x93,0xA7,0x00}, {0x8D,0xAA,0x00}, {0x88,0xAD,0x00}, {0x84,0xAF,0x00}, {0x7E,0xB2,0x00},
+  {0x79,0xB5,0x00}, {0x75,0xB6,0x00}, {0x6F,0xB9,0x00}, {0x6A,0xBC,0x00}, {0x66,0xBE,0x00}, {0x60,0xC1,0x00},
+  {0x5B,0xC4,0x00}, {0x57,0xC5,0x00}, {0x51,0xC8,0x00}, {0x4C,0xCB,0x00}, {0x48,0xCD,0x00}, {0x43,0xD0,0x00},
+  {0x3D,0xD3,0x00}, {0x39,0xD4,0x00}, {0x34,0xD7,0x00}, {0x2E,0xDA,0x00}, {0x2A,0xDC,0x00}, {0x25,0xDF,0x00},
+  {0x1F,0xE2,0x00}, {0x1B,0xE3,0x00}, {0x16,0xE6,0x00}, {0x10,0xE9,0x00}, {0x0C,0xEB,0x00}, {0x07,0xEE,0x00},
+  {0x00,0xF0,0x00}, {0x00,0xEE,0x02}, {0x00,0xEB,0x05}, {0x00,0xE9,0x07}, {0x00,0xE6,0x0A}, {0x00,0xE3,0x0D},
+  {0x00,0xE2,0x0F}, {0x00,0xDF,0x11}, {0x00,0xDC,0x14}, {0x00,0xDA,0x16}, {0x00,0xD7,0x19}, {0x00,0xD4,0x1C},
+  {0x00,0xD3,0x1E}, {0x00,0xD0,0x20}, {0x00,0xCD,0x23}, {0x00,0xCB,0x25}, {0x00,0xC8,0x28}, {0x00,0xC5,0x2B},
+  {0x00,0xC4,0x2D}, {0x00,0xC1,0x2F}, {0x00,0xBE,0x32}, {0x00,0xBC,0x34}, {0x00,0xB9,0x37}, {0x00,0xB6,0x3A},
+  {0x00,0xB5,0x3C}, {0x00,0xB2,0x3E}, {0x00,0xAF,0x41}, {0x00,0xAD,0x43}, {0x00,0xAA,0x46}, {0x00,0xA7,0x49},
+  {0x00,0xA6,0x4B}, {0x00,0xA3,0x4D}, {0x00,0xA1,0x50}, {0x00,0x9C,0x55}, {0x00,0x97,0x5A}, {0x00,0x93,0x5E},
+  {0x00,0x8D,0x64}, {0x00,0x88,0x69}, {0x00,0x84,0x6D}, {0x00,0x7E,0x73}, {0x00,0x79,0x78}, {0x00,0x75,0x7C},
+  {0x00,0x6F,0x82}, {0x00,0x6A,0x87}, {0x00,0x66,0x8B}, {0x00,0x60,0x91}, {0x00,0x5B,0x96}, {0x00,0x57,0x9A},
+  {0x00,0x51,0xA0}, {0x00,0x4C,0xA5}, {0x00,0x48,0xA9}, {0x00,0x43,0xAE}, {0x00,0x3D,0xB4}, {0x00,0x39,0xB8},
+  {0x00,0x34,0xBD}, {0x00,0x2E,0xC3}, {0x00,0x2A,0xC7}, {0x00,0x25,0xCC}, {0x00,0x1F,0xD2}, {0x00,0x1B,0xD6},
+  {0x00,0x16,0xDB}, {0x00,0x10,0xE1}, {0x00,0x0C,0xE5}, {0x00,0x07,0xEA}, {0x00,0x00,0xF0}, {0x02,0x00,0xEE},
+  {0x05,0x00,0xEB}, {0x07,0x00,0xE9}, {0x0A,0x00,0xE6}, {0x0D,0x00,0xE3}, {0x0F,0x00,0xE2}, {0x11,0x00,0xDF},
+  {0x14,0x00,0xDC}, {0x16,0x00,0xDA}, {0x19,0x00,0xD7}, {0x1C,0x00,0xD4}, {0x1E,0x00,0xD3}, {0x20,0x00,0xD0},
+  {0x23,0x00,0xCD}, {0x25,0x00,0xCB}, {0x28,0x00,0xC8}, {0x2B,0x00,0xC5}, {0x2D,0x00,0xC4}, {0x2F,0x00,0xC1},
+  {0x32,0x00,0xBE}, {0x34,0x00,0xBC}, {0x37,0x00,0xB9}, {0x3A,0x00,0xB6}, {0x3C,0x00,0xB5}, {0x3E,0x00,0xB2},
+  {0x41,0x00,0xAF}, {0x43,0x00,0xAD}, {0x46,0x00,0xAA}, {0x49,0x00,0xA7}, {0x4B,0x00,0xA6}, {0x4D,0x00,0xA3},
+  {0x50,0x00,0xA1}, {0x52,0x00,0x9F}, {0x55,0x00,0x9C}, {0x57,0x00,0x9A}, {0x5A,0x00,0x97}, {0x5C,0x00,0x95},
+  {0x5E,0x00,0x93}, {0x61,0x00,0x90}, {0x64,0x00,0x8D}, {0x66,0x00,0x8B}, {0x69,0x00,0x88}, {0x6B,0x00,0x86},
+  {0x6D,0x00,0x84}, {0x70,0x00,0x81}, {0x73,0x00,0x7E}, {0x75,0x00,0x7C}, {0x78,0x00,0x79}, {0x7A,0x00,0x77},
+  {0x7C,0x00,0x75}, {0x7F,0x00,0x72}, {0x82,0x00,0x6F}, {0x84,0x00,0x6D}, {0x87,0x00,0x6A}, {0x89,0x00,0x68},
+  {0x8B,0x00,0x66}, {0x8E,0x00,0x63}, {0x91,0x00,0x60}, {0x93,0x00,0x5E}, {0x96,0x00,0x5B}, {0x98,0x00,0x59},
+  {0x9A,0x00,0x57}, {0x9D,0x00,0x54}, {0xA1,0x00,0x50}, {0xA3,0x00,0x4E}, {0xA6,0x00,0x4C}, {0xA7,0x00,0x4A},
+  {0xAA,0x00,0x47}, {0xAD,0x00,0x44}, {0xAF,0x00,0x42}, {0xB2,0x00,0x3F}, {0xB5,0x00,0x3D}, {0xB6,0x00,0x3B},
+  {0xB9,0x00,0x38}, {0xBC,0x00,0x35}, {0xBE,0x00,0x33}, {0xC1,0x00,0x30}, {0xC4,0x00,0x2E}, {0xC5,0x00,0x2C},
+  {0xC8,0x00,0x29}, {0xCB,0x00,0x26}, {0xCD,0x00,0x24}, {0xD0,0x00,0x21}, {0xD3,0x00,0x1F}, {0xD4,0x00,0x1D},
+  {0xD7,0x00,0x1A}, {0xDA,0x00,0x17}, {0xDC,0x00,0x15}, {0xDF,0x00,0x12}, {0xE2,0x00,0x10}, {0xE3,0x00,0x0E},
+  {0xE6,0x00,0x0B}, {0xE9,0x00,0x08}, {0xEB,0x00,0x06}, {0xEE,0x00,0x03}
+};
+
+// The hue only depends on how many steps have passed, so however many a
+// frame covers it is drawn once
+template<class Layout>
+bool RainbowEffect<Layout>::renderFrame(Light &light, uint32_t dt) {
+  loop_count -= steps.advance(dt);
+  uint8_t hue = loop_count/4;
+  if (hue == lastHue)
+    return false;
+  lastHue = hue;
+
+  CRGB *leds = light.getLeds();
+  for (int i = 0; i < Layout::LENGTH; i++) {
+    leds[i].setRGB(rainbowRamp[hue][0], rainbowRamp[hue][1], rainbowRamp[hue][2]);
+    hue += 2;
+  }
+  return true;
+}
+
+const CRGB christmasPalette[3] = { CRGB::Red, CRGB::Green, CRGB::Blue };
+
+template<class Layout>
+ChristmasEffect<Layout>::ChristmasEffect(const CRGB *palette, uint8_t paletteSize, uint8_t bandWidth)
+  : palette(palette), paletteSize(paletteSize), bandWidth(bandWidth) {
+}
+
+// Set the pixels distance+1 either side of the mirror
+template<class Layout>
+void ChristmasEffect<Layout>::paint(CRGB *leds, uint16_t distance, const CRGB &color) {
+  leds[Layout::afterMirror(distance)] = color;
+  leds[Layout::beforeMirror(distance)] = color;
+}
+
+template<class Layout>
+bool ChristmasEffect<Layout>::advance(Light &light) {
+  CRGB *leds = light.getLeds();
+  bool changed = tick == 0;
+  if (changed && !painted) {
+    uint8_t band = step / bandWidth;
+    uint8_t offset = step % bandWidth;
+    for (uint16_t i = 0; i < Layout::HALF; i++) {
+      paint(leds, i, palette[band]);
+      if (++offset == bandWidth) {
+        offset = 0;
+        if (++band == paletteSize)
+          band = 0;
+      }
+    }
+    painted = true;
+  } else if (changed) {
+    // The pattern moved one pixel towards the mirror, so only the first
+    // pixel of each band needs its new colour
+    uint16_t i = (bandWidth - step % bandWidth) % bandWidth;
+    uint8_t band = (step + i) / bandWidth % paletteSize;
+    for (; i < Layout::HALF; i += bandWidth) {
+      paint(leds, i, palette[band]);
+      if (++band == paletteSize)
+        band = 0;
+    }
+  }
+
+  if (++tick == CHRISTMAS_STEP_TICKS) {
+    tick = 0;
+    if (++step == bandWidth * paletteSize)
+      step = 0;
+  }
+
+  return changed;
+}
+
+template<class Layout>
+void MeteorsEffect<Layout>::begin(Light &light) {
+  color[0] = light.randomBrightColor(true);
+  color[1] = light.randomBrightColor(true);
+}
+
+template<class Layout>
+void MeteorsEffect<Layout>::addColorToLed(CRGB *leds, uint16_t p, CRGB c) {
+  leds[p].r = qadd8(c.r, leds[p].r);
+  leds[p].g = qadd8(c.g, leds[p].g);
+  leds[p].b = qadd8(c.b, leds[p].b);
+}
+
+template<class Layout>
+bool MeteorsEffect<Layout>::advance(Light &light) {
+  CRGB *leds = light.getLeds();
+
+  fadeToBlackBy(leds, Layout::LENGTH, random8(5, 20));
+
+  for (uint8_t m = 0; m <= 1; m++) {
+    if (loop_count % speed[m] == 0) {
+      addColorToLed(leds, position[m], color[m]);
+      position[m]++;
+    }
+
+    if (position[m] >= Layout::LENGTH) {
+      position[m] = 0;
+      color[m] = light.randomBrightColor(true);
+      speed[m] = random8(1,3); // random number between 1 and 2
+    }
+  }
+  loop_count++;
+  return true;
+}
+
+template<class Layout>
+void LightSwipeEffect<Layout>::begin(Light &light) {
+  targetColor = light.randomBrightColor(false);
+}
+
+template<class Layout>
+bool LightSwipeEffect<Layout>::advance(Light &light) {
+  CRGB *leds = light.getLeds();
+
+  leds[loop_count++] = CRGB::White;
+
+  for (int i = 0; i < Layout::LENGTH; i++) {
+    if (i < loop_count) {
+      if (leds[i].r > targetColor.r)
+        leds[i].r -= 5;
+      if (leds[i].g > targetColor.g)
+        leds[i].g -= 5;
+      if (leds[i].b > targetColor.b)
+        leds[i].b -= 5;
+    } else if (i > loop_count) {
+      if (leds[i].r > previousColor.r)
+        leds[i].r -= 5;
+      if (leds[i].g > previousColor.g)
+        leds[i].g -= 5;
+      if (leds[i].b > previousColor.b)
+        leds[i].b -= 5;
+    }
+  }
+
+  if (loop_count >= Layout::LENGTH) {
+    loop_count = 0;
+    previousColor = targetColor;
+    targetColor = light.randomBrightColor(false);
+  }
+  return true;
+}
+
+// The pixel in front of a bounce's head
+template<class Layout, uint8_t BALLS, uint8_t TAIL>
+uint16_t BounceEffect<Layout, BALLS, TAIL>::ahead(uint8_t i) {
+  return Layout::step(bounces[i].position[0], bounces[i].direction);
+}
+
+template<class Layout, uint8_t BALLS, uint8_t TAIL>
+void BounceEffect<Layout, BALLS, TAIL>::reverse(uint8_t i) {
+  if (bounces[i].direction) {
+    forwards--;
+    backwards++;
+  } else {
+    backwards--;
+    forwards++;
+  }
+  bounces[i].direction = !bounces[i].direction;
+}
+
+template<class Layout, uint8_t BALLS, uint8_t TAIL>
+void BounceEffect<Layout, BALLS, TAIL>::buildMaps() {
+  memset(headMap, 0, sizeof(headMap));
+  memset(sharedHeadMap, 0, sizeof(sharedHeadMap));
+  memset(tailMap, 0, sizeof(tailMap));
+  for (int i = 0; i < BALLS; i++) {
+    if (!bounces[i].enabled)
+      continue;
+
+    uint16_t head = bounces[i].position[0];
+    if (marked(headMap, head))
+      mark(sharedHeadMap, head);
+    mark(headMap, head);
+    mark(tailMap, bounces[i].position[TAIL-1]);
+  }
+}
+
+// Bounces after i heading the other way whose head is on, or just in front
+// of, i's head, taken in index order
+template<class Layout, uint8_t BALLS, uint8_t TAIL>
+void BounceEffect<Layout, BALLS, TAIL>::faceOnCollisions(uint8_t i) {
+  uint16_t here = bounces[i].position[0];
+  uint16_t next = ahead(i);
+  // i's own head is always on here, so look for a second one
+  if (!marked(headMap, next) && !marked(sharedHeadMap, here))
+    return;
+
+  for (uint8_t a = i + 1; a < BALLS; a++) {
+    uint16_t head = bounces[a].position[0];
+    if (!bounces[a].enabled || (head != here && head != next) ||
+        bounces[i].direction == bounces[a].direction)
+      continue;
+
+    if (bounces[i].speed == 2)
+      bounces[i].fadeOut = true;
+    else
+      bounces[i].speed--;
+
+    if (bounces[a].speed == 2)
+      bounces[a].fadeOut = true;
+    else
+      bounces[a].speed--;
+
+    reverse(i);
+    reverse(a);
+  }
+}
+
+// Slower bounces going the same way whose tail is on, or just in front of,
+// i's head, taken in index order
+template<class Layout, uint8_t BALLS, uint8_t TAIL>
+void BounceEffect<Layout, BALLS, TAIL>::rearCollisions(uint8_t i) {
+  uint16_t here = bounces[i].position[0];
+  uint16_t next = ahead(i);
+  if (!marked(tailMap, next) && !marked(tailMap, here))
+    return;
+
+  for (uint8_t a = 0; a < BALLS; a++) {
+    uint16_t tail = bounces[a].position[TAIL-1];
+    if (a == i || !bounces[a].enabled || (tail != here && tail != next) ||
+        bounces[i].direction != bounces[a].direction ||
+        bounces[i].speed <= bounces[a].speed)
+      continue;
+
+    uint8_t i_speed = 2;
+
+    if (bounces[i].speed == 2)
+      bounces[a].fadeOut = true;
+    else
+      i_speed = bounces[i].speed--;
+
+    if (bounces[a].speed == 2)
+      bounces[i].fadeOut = true;
+    else
+      bounces[i].speed = bounces[a].speed--;
+
+    bounces[a].speed = i_speed;
+  }
+}
+
+template<class Layout, uint8_t BALLS, uint8_t TAIL>
+bool BounceEffect<Layout, BALLS, TAIL>::advance(Light &light) {
+  CRGB *leds = light.getLeds();
+
+  fill_solid(leds, Layout::LENGTH, CRGB::Black);
+
+  // Update bounces
+  for (int i = 0; i < BALLS; i++) {
+    if (!bounces[i].enabled)
+      continue;
+
+    if (loop_count % bounces[i].speed != 0) {
+      for (int8_t a = TAIL-1; a > 0; a--) {
+        bounces[i].position[a] = bounces[i].position[a-1];
+      }
+
+      bounces[i].position[0] = Layout::step(bounces[i].position[1], bounces[i].direction);
+    }
+  }
+
+  // Draw Bounces
+  for (int i = 0; i < BALLS; i++) {
+    if (!bounces[i].enabled)
+      continue;
+
+    for (int a = 0; a < TAIL; a++)
+      leds[bounces[i].position[a]] = bounces[i].color;
+  }
+
+  //
+  // Detect collisions
+  //
+  buildMaps();
+
+  for (uint8_t i = 0; i < BALLS; i++) {
+    if (bounces[i].enabled)
+      faceOnCollisions(i);
+  }
+
+  for (uint8_t i = 0; i < BALLS; i++) {
+    if (bounces[i].enabled)
+      rearCollisions(i);
+  }
+
+  // Deal with stopped bounces
+  for (int i = 0; i < BALLS; i++) {
+    if (bounces[i].fadeOut) {
+
+        bounces[i].color.fadeToBlackBy(2);
+
+      if (!bounces[i].color && bounces[i].enabled) {
+        bounces[i].enabled = false;
+        if (bounces[i].direction)
+          forwards--;
+        else
+          backwards--;
+      }
+    }
+  }
+
+  // Deal with disabled bounces
+  if ((int32_t)(time - nextBounceRelease) >= 0) {
+    for (int i = 0; i < BALLS; i++) {
+      if (!bounces[i].enabled) {
+        nextBounceRelease = time + BOUNCE_RELEASE_INTERVAL;
+        bounces[i].enabled = true;
+        bounces[i].fadeOut = false;
+
+        if (forwards == 0)
+          bounces[i].direction = true;
+        else if (backwards == 0)
+          bounces[i].direction = false;
+        else
+          bounces[i].direction = random8(0, 2);
+
+        if (bounces[i].direction)
+          forwards++;
+        else
+          backwards++;
+
+        bounces[i].position[0] = bounces[i].direction ? 0 : Layout::LAST;
+        for (uint8_t a = 1; a < TAIL; a++)
+          bounces[i].position[a] = bounces[i].position[0];
+
+        bounces[i].color = light.randomBrightColor(true);
+        bounces[i].speed = 20;
+        break;
+      }
+    }
+  }
+  loop_count++;
+  time += ANIMATION_STEP_US;
+  return true;
+}
+
+#ifdef FASTLED_HOST
+// The other ball counts bench_bounce measures scaling over
+template class BounceEffect<LightLayout, 10>;
+template class BounceEffect<LightLayout, 20>;
+template class BounceEffect<LightLayout, 40>;
+template class BounceEffect<LightLayout, 80>;
+template class BounceEffect<LightLayout, 160>;
+// test_effects drives Christmas directly
+template class ChristmasEffect<LightLayout>;
+#endif
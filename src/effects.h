@@ -0,0 +1,184 @@
+#ifndef __EFFECTS_H_
+#define __EFFECTS_H_
+
+#include "FastLED.h"
+#include "strip_layout.h"
+#include "animation_clock.h"
+FASTLED_USING_NAMESPACE
+
+// Default number of balls and their length. Balls are indexed by uint8_t,
+// with 0xFF meaning none.
+#define BOUNCE_ARRAY_SIZE 5
+#define BOUNCE_LENGTH 5
+#define BOUNCE_NONE 0xFF
+
+// Pixels per colour band and how many animation steps each one pixel move
+// takes
+#define CHRISTMAS_BAND_WIDTH 7
+#define CHRISTMAS_STEP_TICKS 3
+
+// Animation time between balls being let back on to the strip
+#define BOUNCE_RELEASE_INTERVAL 2000000
+
+class Light;
+
+/// An animation mode. Only the active effect exists at any time: it is
+/// constructed in Light's effect arena when its mode starts and destroyed
+/// when the next mode takes over, so its state only costs RAM while it runs.
+class Effect {
+public:
+  virtual ~Effect() {}
+  virtual void begin(Light &) {}
+
+  /// Advance the animation by dt microseconds of animation time. Returns
+  /// true if the frame buffer changed, so unchanged frames are never pushed
+  /// to the strip. By default advance() runs once for every ANIMATION_STEP_US
+  /// that has passed, so a late frame catches up rather than slowing the
+  /// animation down; dt never exceeds ANIMATION_MAX_CATCH_UP, the same bound
+  /// the fades replay under.
+  virtual bool renderFrame(Light &light, uint32_t dt);
+  virtual void end(Light &) {}
+
+protected:
+  /// Advance the animation one fixed step.
+  virtual bool advance(Light &) { return false; }
+  StepCounter steps;
+};
+
+// Effects are templated on the strip layout, which must match the one
+// Light's frame buffer is sized for
+
+template<class Layout>
+class StaticEffect : public Effect {
+public:
+  bool advance(Light &light);
+};
+
+/// fill_rainbow() with a hue step of 2, rotated by one hue every fourth
+/// step. Every hue the strip can show is precomputed in a table in flash, so
+/// a frame is a strided copy out of it rather than an HSV conversion per
+/// pixel, and frames where the hue hasn't moved are skipped.
+template<class Layout>
+class RainbowEffect : public Effect {
+  uint16_t loop_count = 0;
+  int16_t lastHue = -1;
+public:
+  bool renderFrame(Light &light, uint32_t dt);
+};
+
+extern const CRGB christmasPalette[3];
+
+/// Bands of palette colours scrolling from both ends of the strip towards
+/// the layout's mirror pixel. The whole pattern is painted once; after that
+/// each move only rewrites the pixels that crossed into the next band, one
+/// per band on each side.
+template<class Layout>
+class ChristmasEffect : public Effect {
+  const CRGB *palette;
+  uint8_t paletteSize;
+  uint8_t bandWidth;
+  uint8_t tick = 0;
+  uint16_t step = 0;
+  bool painted = false;
+  void paint(CRGB *leds, uint16_t distance, const CRGB &color);
+public:
+  ChristmasEffect(const CRGB *palette = christmasPalette, uint8_t paletteSize = 3,
+                  uint8_t bandWidth = CHRISTMAS_BAND_WIDTH);
+  bool advance(Light &light);
+};
+
+template<class Layout>
+class MeteorsEffect : public Effect {
+  CRGB color[2];
+  uint16_t position[2] = {0, 0};
+  uint8_t speed[2] = {1, 2};
+  uint16_t loop_count = 0;
+  void addColorToLed(CRGB *leds, uint16_t p, CRGB c);
+public:
+  void begin(Light &light);
+  bool advance(Light &light);
+};
+
+template<class Layout>
+class LightSwipeEffect : public Effect {
+  CRGB targetColor;
+  CRGB previousColor = CRGB::Black;
+  uint16_t loop_count = 0;
+public:
+  void begin(Light &light);
+  bool advance(Light &light);
+};
+
+/// Balls running round the ring, reversing when they meet head on and
+/// trading speed when a faster one catches up. Bitmaps of the pixels with a
+/// head or a tail on them rule out a collision with one bit test, so the
+/// balls are only searched when one is about to happen and the cost grows
+/// linearly with the number of balls.
+template<class Layout, uint8_t BALLS = BOUNCE_ARRAY_SIZE, uint8_t TAIL = BOUNCE_LENGTH>
+class BounceEffect : public Effect {
+  static_assert(BALLS < BOUNCE_NONE, "too many balls for uint8_t indices");
+
+  struct BounceData {
+    bool enabled = false;
+    bool fadeOut = false;
+    bool direction = true;
+    uint8_t speed = 20;
+    uint16_t position[TAIL];
+    CRGB color = CRGB::White;
+  };
+  BounceData bounces[BALLS];
+  // Pixels with at least one head/tail on them, and with more than one
+  // head, a bit each
+  static const uint16_t MAP_WORDS = (Layout::LENGTH + 31) / 32;
+  uint32_t headMap[MAP_WORDS];
+  uint32_t sharedHeadMap[MAP_WORDS];
+  uint32_t tailMap[MAP_WORDS];
+  // Enabled balls going each way
+  uint8_t forwards = 0;
+  uint8_t backwards = 0;
+  // Animation time of the steps this effect has run, so a step replayed in
+  // a catch-up sees its own time, and when the next ball may come on; the
+  // first one goes straight on
+  uint32_t time = 0;
+  uint32_t nextBounceRelease = 0;
+  uint16_t loop_count = 0;
+  uint16_t ahead(uint8_t i);
+  void reverse(uint8_t i);
+  static void mark(uint32_t *map, uint16_t p) { map[p / 32] |= 1UL << (p % 32); }
+  static bool marked(const uint32_t *map, uint16_t p) { return map[p / 32] & (1UL << (p % 32)); }
+  void buildMaps();
+  void faceOnCollisions(uint8_t i);
+  void rearCollisions(uint8_t i);
+public:
+  bool advance(Light &light);
+};
+
+constexpr size_t maxEffectSize(size_t a, size_t b) {
+  return a > b ? a : b;
+}
+
+/// Room for whichever registered effect is largest on a layout.
+template<class Layout>
+constexpr size_t effectArenaSize() {
+  return maxEffectSize(sizeof(StaticEffect<Layout>),
+         maxEffectSize(sizeof(RainbowEffect<Layout>),
+         maxEffectSize(sizeof(ChristmasEffect<Layout>),
+         maxEffectSize(sizeof(MeteorsEffect<Layout>),
+         maxEffectSize(sizeof(LightSwipeEffect<Layout>),
+                       sizeof(BounceEffect<Layout>))))));
+}
+
+// Sized for Light's strip in light.h
+struct EffectArena;
+
+/// Construct the effect registered for a mode inside the arena. Returns
+/// NULL for modes without an effect.
+Effect *createEffect(uint8_t mode, EffectArena &arena);
+
+/// Name a mode is known by over MQTT, or NULL for modes without an effect.
+const char *effectName(uint8_t mode);
+
+/// Mode registered under a name, or Light::NONE if there is none.
+uint8_t effectMode(const char *name);
+
+#endif
@@ -0,0 +1,85 @@
+#include <string.h>
+#include "frame_scheduler.h"
+
+FrameScheduler::FrameScheduler(uint32_t stepInterval, uint32_t minShowInterval, uint32_t maxShowInterval) :
+  stepInterval(stepInterval), minShowInterval(minShowInterval), maxShowInterval(maxShowInterval),
+  showInterval(minShowInterval) {
+  resetStats();
+}
+
+void FrameScheduler::setCpuBudget(uint8_t percent) {
+  if (percent == 0 || percent > 100)
+    percent = 100;
+
+  cpuBudget = percent;
+  updateShowInterval();
+}
+
+bool FrameScheduler::stepDue(uint32_t now) {
+  uint32_t elapsed = now - lastStep;
+  if (elapsed < stepInterval)
+    return false;
+
+  lastStep = now;
+
+  // A step is late once a whole interval has been lost
+  uint32_t late = (elapsed - stepInterval) / stepInterval;
+  if (late > 0) {
+    uint8_t bucket = 0;
+    while (late > 1 && bucket < FRAME_MISS_BUCKETS-1) {
+      late >>= 1;
+      bucket++;
+    }
+    misses[bucket]++;
+  }
+
+  return true;
+}
+
+bool FrameScheduler::showDue(uint32_t now) {
+  if (now - lastShow < showInterval)
+    return false;
+
+  lastShow = now;
+  return true;
+}
+
+void FrameScheduler::recordRender(uint32_t micros) {
+  avgRender = (avgRender * 7 + micros) / 8;
+  if (micros > maxRender)
+    maxRender = micros;
+  updateShowInterval();
+}
+
+void FrameScheduler::recordShow(uint32_t micros) {
+  avgShow = (avgShow * 7 + micros) / 8;
+  if (micros > maxShow)
+    maxShow = micros;
+  updateShowInterval();
+}
+
+void FrameScheduler::resetStats() {
+  maxRender = 0;
+  maxShow = 0;
+  memset(misses, 0, sizeof(misses));
+}
+
+// Pick the shortest show interval for which
+//   avgRender / stepInterval + avgShow / showInterval <= cpuBudget / 100
+void FrameScheduler::updateShowInterval() {
+  uint64_t available = (uint64_t)cpuBudget * stepInterval;
+  uint64_t renderCost = (uint64_t)avgRender * 100;
+
+  uint32_t interval;
+  if (renderCost >= available)
+    interval = maxShowInterval;
+  else
+    interval = (uint64_t)avgShow * 100 * stepInterval / (available - renderCost);
+
+  if (interval < minShowInterval)
+    interval = minShowInterval;
+  else if (interval > maxShowInterval)
+    interval = maxShowInterval;
+
+  showInterval = interval;
+}
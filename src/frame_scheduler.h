@@ -0,0 +1,58 @@
+#ifndef __FRAME_SCHEDULER_H_
+#define __FRAME_SCHEDULER_H_
+
+#include <stdint.h>
+
+#define FRAME_MISS_BUCKETS 6
+
+/// Decides when Light steps its animation and when it pushes a frame to the
+/// strip. Effect compute time and show() wire time are measured separately,
+/// and the show interval is stretched whenever the two together would use
+/// more than the CPU budget, leaving the rest of each second to MQTT and the
+/// cloud. Animation steps that start late are counted in a histogram.
+class FrameScheduler {
+public:
+  FrameScheduler(uint32_t stepInterval = 10000, uint32_t minShowInterval = 20000, uint32_t maxShowInterval = 100000);
+
+  /// Share of the CPU (in percent) rendering and showing frames may take.
+  void setCpuBudget(uint8_t percent);
+  uint8_t getCpuBudget() const { return cpuBudget; }
+
+  bool stepDue(uint32_t now);
+  bool showDue(uint32_t now);
+
+  void recordRender(uint32_t micros);
+  void recordShow(uint32_t micros);
+
+  uint32_t getStepInterval() const { return stepInterval; }
+  uint32_t getShowInterval() const { return showInterval; }
+  uint32_t getAverageRender() const { return avgRender; }
+  uint32_t getAverageShow() const { return avgShow; }
+  uint32_t getMaxRender() const { return maxRender; }
+  uint32_t getMaxShow() const { return maxShow; }
+
+  /// Number of steps that started late, bucketed by how late they were:
+  /// 1, 2, 4, 8, 16 and 32 or more step intervals.
+  uint32_t getMisses(uint8_t bucket) const { return misses[bucket]; }
+  void resetStats();
+
+private:
+  void updateShowInterval();
+
+  uint32_t stepInterval;
+  uint32_t minShowInterval;
+  uint32_t maxShowInterval;
+  uint32_t showInterval;
+  uint8_t cpuBudget = 60;
+
+  uint32_t lastStep = 0;
+  uint32_t lastShow = 0;
+
+  uint32_t avgRender = 0;
+  uint32_t avgShow = 0;
+  uint32_t maxRender = 0;
+  uint32_t maxShow = 0;
+  uint32_t misses[FRAME_MISS_BUCKETS];
+};
+
+#endif
@@ -1,10 +1,14 @@
 #include "light.h"
 
+Light::Light(LightPlatform &platform) : platform(&platform) {
+}
+
 void Light::setup() {
-  FastLED.addLeds<WS2812, LED_PIN, GRB>(leds, LED_COUNT);
-  FastLED.clear();
-  FastLED.setBrightness(0);
-  FastLED.show();
+  resetEffectStats();
+  platform->begin(leds, LED_LANES * LED_LANE_LENGTH);
+  platform->setGamma(LED_GAMMA);
+  animationClock.start(platform->micros());
+  startEffect(mode);
 }
 
 void Light::on() {
@@ -65,27 +69,26 @@ void Light::setMode(MODES newMode) {
   targetMode = newMode;
 }
 
+void Light::startEffect(MODES newMode) {
+  if (effect) {
+    effect->end(*this);
+    effect->~Effect();
+  }
+
+  effect = createEffect(newMode, effectArena);
+  if (effect)
+    effect->begin(*this);
+}
+
 void Light::changeModeTo(MODES newMode) {
   mode = newMode;
-  FastLED.clear();
-  loop_count = 0;
-
-  if (newMode == METEORS) {
-    meteorColor[0] = randomBrightColor(true);
-    meteorColor[1] = randomBrightColor(true);
-    meteorPosition[0] = 0;
-    meteorPosition[1] = 0;
-  } else if (newMode == STATIC) {
+  fill_solid(leds, LightLayout::LENGTH, CRGB::Black);
+  frameDirty = true;
+
+  if (newMode == STATIC)
     targetColor = savedColor;
-    targetMode = STATIC;
-  } else if (newMode == LIGHT_SWIPE) {
-    targetColor = randomBrightColor(false);
-    previousColor = CRGB::Black;
-  } else if (newMode == BOUNCE) {
-    for (int i = 1; i < BOUNCE_ARRAY_SIZE; i++) {
-      bounces[i].enabled = false;
-    }
-  }
+
+  startEffect(newMode);
 }
 
 Light::MODES Light::getMode() {
@@ -95,36 +98,15 @@ Light::MODES Light::getMode() {
   return mode;
 }
 
-void Light::updateLeds() {
-  bool changesMade = false;
-
-  for (int i = 0; i < 3; i++) {
-    if (leds[0][i] != targetColor[i]) {
-      changesMade = true;
-      if (targetColor[i] > leds[0][i]) {
-        leds[0][i] = targetColor[i]-leds[0][i] > 5 ? leds[0][i]+5 : targetColor[i];
-      } else {
-        leds[0][i] = leds[0][i]-targetColor[i] > 5 ? leds[0][i]-5 : targetColor[i];
-      }
-    }
-  }
-  
-  if (changesMade)// || leds[0] != leds)
-    fill_solid(leds, LED_COUNT, leds[0]);
-
-  colorPublished = changesMade ? false : colorPublished;
-}
+void Light::loadSettings() {
+  SaveData saveData = SaveData();
 
-void Light::addColorToLed(uint16_t p, CRGB c) {
-  leds[p].r = qadd8(c.r, leds[p].r);
-  leds[p].g = qadd8(c.g, leds[p].g);
-  leds[p].b = qadd8(c.b, leds[p].b);  
-}
+  // Fall back to the fixed record older firmware wrote at address 0
+  if (!settingsJournal.load(*platform, &saveData))
+    platform->readSettings(0, &saveData, sizeof(saveData));
 
-void Light::loadSettings() {
-  SaveData saveData;
-  EEPROM.get(0, saveData);
-  if (saveData.mode > 0) {
+  savedSettings = saveData;
+  if (saveData.mode > 0 && saveData.mode <= BOUNCE) {
     mode = saveData.mode;
     savedBrightness = saveData.brightness;
     savedColor = saveData.color;
@@ -132,20 +114,27 @@ void Light::loadSettings() {
   }
 }
 
+// Only schedules a save; loop() writes once the settings have been stable
+// for SETTINGS_SAVE_DELAY, so a dragged slider costs one write, not dozens.
 void Light::saveSettings() {
-  SaveData saveData;
-  saveData.mode = mode;
+  settingsDirty = true;
+  settingsChangedAt = platform->micros();
+}
+
+void Light::commitSettings() {
+  // Value-initialised, so every byte is zero before the fields go in and
+  // the memcmp below only sees the settings
+  SaveData saveData = SaveData();
+  saveData.mode = getMode();
   saveData.brightness = savedBrightness;
   saveData.color = savedColor;
-  EEPROM.put(0, saveData);
-}
 
-bool Light::isColorPublished() {
-  if (!colorPublished) {
-    colorPublished = true;
-    return false;
-  }
-  return true;
+  settingsDirty = false;
+  if (memcmp(&saveData, &savedSettings, sizeof(saveData)) == 0)
+    return;
+
+  settingsJournal.save(*platform, &saveData);
+  savedSettings = saveData;
 }
 
 void Light::setBrightness(uint8_t b) {
@@ -157,289 +146,153 @@ uint8_t Light::getBrightness() {
   return savedBrightness;
 }
 
-void Light::loop() {
-  uint32_t tick_time = System.ticks() / System.ticksPerMicrosecond();//) - lastRuntime;
-
-
-  if (tick_time - lastRuntime >= 10000) {
-    lastRuntime = tick_time;
-
-    if (targetMode) {
-      if (brightness == 0 && targetMode != NONE) {
-        changeModeTo(targetMode);
-        targetMode = NONE;
-      }
-
-      brightness = brightness > 5 ? brightness-5 : 0;
-
-      FastLED.setBrightness(brightness);
-    } else if (brightness != targetBrightness) {
-      if (targetBrightness > brightness)
-        brightness = targetBrightness - brightness > 5 ? brightness+5 : targetBrightness;
-      else
-        brightness = brightness - targetBrightness > 5 ? brightness-5 : targetBrightness;
-
-      FastLED.setBrightness(brightness);
-    }
-
-  
-    // We need to continue all animations until
-    // we're powered off and the brightness is 0
-    if (powerState || brightness > 0) {
-      if (mode == STATIC) {
-        updateLeds();
-      } else if (mode == RAINBOW) {
-        loop_count--;
-        fill_rainbow( leds, LED_COUNT, loop_count/4, 2);
-      } else if (mode == CHRISTMAS) {
-        if (loop_count % 3 == 0) {
-          for (uint16_t i = 0; i < (LED_COUNT/2); i++) {
-            uint8_t t = ((loop_count/3) + i) / 7 % 3;
-            CRGB color;
-            if (t == 0) {
-              color = CRGB::Red;
-            } else if (t == 1) {
-              color = CRGB::Green;
-            } else {
-              color = CRGB::Blue;
-            }
-
-            int16_t l = 231 + i;
-            int16_t r = 229 - i;
-
-            if (l >= LED_COUNT)
-              l -= LED_COUNT;
-
-            leds[l] = color;
-            leds[r] = color;
-          }
-        }
-        loop_count++;
-
-        if (loop_count >= 63) // 63 is divisible by 7 and 3
-          loop_count = 0;
+CRGB *Light::getLeds() {
+  return leds;
+}
 
-      } else if (mode == METEORS) {
-        fadeToBlackBy(leds, LED_COUNT, random8(5, 20));
+CRGB Light::getTargetColor() {
+  return targetColor;
+}
 
-        for (uint8_t m = 0; m <= 1; m++) {
-          if (loop_count % meteorSpeed[m] == 0) {
-            addColorToLed(meteorPosition[m], meteorColor[m]);
-            meteorPosition[m]++;
-          }
+uint32_t Light::now() {
+  return platform->now();
+}
 
-          if (meteorPosition[m] >= LED_COUNT) {
-            meteorPosition[m] = 0;
-            meteorColor[m] = randomBrightColor(true);
-            meteorSpeed[m] = random8(1,3); // random number between 1 and 2
-          }
-        }
-        loop_count++;
-      } else if (mode == LIGHT_SWIPE) {
-        leds[loop_count++] = CRGB::White;
-
-        for (int i = 0; i < LED_COUNT; i++) {
-          if (i < loop_count) {
-            if (leds[i].r > targetColor.r)
-              leds[i].r -= 5;
-            if (leds[i].g > targetColor.g)
-              leds[i].g -= 5;
-            if (leds[i].b > targetColor.b)
-              leds[i].b -= 5;
-          } else if (i > loop_count) {
-            if (leds[i].r > previousColor.r)
-              leds[i].r -= 5;
-            if (leds[i].g > previousColor.g)
-              leds[i].g -= 5;
-            if (leds[i].b > previousColor.b)
-              leds[i].b -= 5;
-          }
-        }
+uint32_t Light::animationTime() {
+  return animationClock.time();
+}
 
-        if (loop_count >= LED_COUNT) {
-          loop_count = 0;
-          previousColor = targetColor;
-          targetColor = randomBrightColor(false);
-        }
-      } else if (mode == BOUNCE) {
-        FastLED.clear();
-
-        // Update bounces
-        for (int i = 0; i < BOUNCE_ARRAY_SIZE; i++) {
-          if (!bounces[i].enabled)
-            continue;
-
-          if (loop_count % bounces[i].speed != 0) {
-            for (int8_t a = BOUNCE_LENGTH-1; a > 0; a--) {
-              bounces[i].position[a] = bounces[i].position[a-1];
-            }
-          
-            if (bounces[i].direction) {
-              bounces[i].position[0] = bounces[i].position[1] + 1;
-            } else {
-              bounces[i].position[0] = bounces[i].position[1] - 1;
-            }
-
-            if (bounces[i].position[0] >= LED_COUNT) {
-              if (bounces[i].direction)
-                bounces[i].position[0] = 0;
-              else
-                bounces[i].position[0] = LED_COUNT-1;
-            }
-          }
-        }
+const Light::EffectStats &Light::getEffectStats(MODES m) {
+  return effectStats[m];
+}
 
-        // Draw Bounces
-        for (int i = 0; i < BOUNCE_ARRAY_SIZE; i++) {
-          if (!bounces[i].enabled)
-            continue;
-          
-          for (int a = 0; a < BOUNCE_LENGTH; a++) {
-            if (bounces[i].position[a] < LED_COUNT-1)
-              leds[bounces[i].position[a]] = bounces[i].color;
-          }
-        }
+void Light::resetEffectStats() {
+  memset(effectStats, 0, sizeof(effectStats));
+}
 
-        //
-        // Detect collisions
-        //
-        // Face-on-collisions
-        for (uint8_t i = 0; i < BOUNCE_ARRAY_SIZE; i++) {
-          if (!bounces[i].enabled)
-            continue;
-
-          uint16_t collision = bounces[i].direction ? bounces[i].position[0]+1 : bounces[i].position[0]-1;
-
-          if (collision >= LED_COUNT)
-            collision = bounces[i].direction ? 0 : LED_COUNT-1;
-   
-          for (uint8_t a = i+1; a < BOUNCE_ARRAY_SIZE; a++) {
-            if (!bounces[a].enabled ||
-                bounces[i].direction == bounces[a].direction)
-              continue;
-            
-            if (bounces[a].position[0] == collision || bounces[i].position[0] == bounces[a].position[0]) {
-              if (bounces[i].speed == 2)
-                bounces[i].fadeOut = true;
-              else
-                bounces[i].speed--;
-
-              if (bounces[a].speed == 2)
-                bounces[a].fadeOut = true;
-              else
-                bounces[a].speed--;
-
-              bounces[i].direction = !bounces[i].direction;
-              bounces[a].direction = !bounces[a].direction;
-            }
-          }
-        }
+void Light::setCpuBudget(uint8_t percent) {
+  scheduler.setCpuBudget(percent);
+}
 
+void Light::resetFrameStats() {
+  scheduler.resetStats();
+}
 
-        // Rear collisions
-        for (int i = 0; i < BOUNCE_ARRAY_SIZE; i++) {
-          if (!bounces[i].enabled)
-            continue;
+const FrameScheduler &Light::getScheduler() {
+  return scheduler;
+}
 
-          uint16_t collision = bounces[i].direction ? bounces[i].position[0]+1 : bounces[i].position[0]-1;
-          
-          if (collision >= LED_COUNT)
-            collision = bounces[i].direction ? 0 : LED_COUNT-1;
+void Light::setGamma(float gamma) {
+  platform->setGamma(gamma);
+  frameDirty = true;
+}
 
-          for (int a = 0; a < BOUNCE_ARRAY_SIZE; a++) {
-            if (a == i ||
-                !bounces[a].enabled ||
-                bounces[i].direction != bounces[a].direction ||
-                bounces[i].speed <= bounces[a].speed)
-              continue;
+void Light::setPowerBudget(uint32_t mW) {
+  powerLimiter.setBudget(mW);
+  frameDirty = true;
+}
 
-            if (bounces[a].position[BOUNCE_LENGTH-1] == collision || bounces[a].position[BOUNCE_LENGTH-1] == bounces[i].position[0]) {
-              uint8_t i_speed = 2;
+const PowerLimiter &Light::getPowerLimiter() {
+  return powerLimiter;
+}
 
-              if (bounces[i].speed == 2)
-                bounces[a].fadeOut = true;
-              else
-                i_speed = bounces[i].speed--;
+// Fades move by a sixteenth of the current level, so they look even to the
+// eye and take about as long end to end as fixed steps of 5 did, but creep
+// through the bottom of the range a step at a time
+static uint8_t fadeStep(uint8_t level) {
+  return 1 + level / 16;
+}
 
-              if (bounces[a].speed == 2)
-                bounces[i].fadeOut = true;
-              else
-                bounces[i].speed = bounces[a].speed--;
+void Light::loop() {
+  uint32_t tick_time = platform->micros();
 
-              bounces[a].speed = i_speed;
-            }
-          }
-        }
+  if (settingsDirty && tick_time - settingsChangedAt >= SETTINGS_SAVE_DELAY)
+    commitSettings();
 
-        // Deal with stopped bounces
-        for (int i = 0; i < BOUNCE_ARRAY_SIZE; i++) {
-          if (bounces[i].fadeOut) {
 
-              bounces[i].color.fadeToBlackBy(2);
+  if (scheduler.stepDue(tick_time)) {
+    uint32_t dt = animationClock.advance(tick_time);
 
-            if (!bounces[i].color)
-              bounces[i].enabled = false;
-          }
+    // Fades count animation steps too, so a stalled loop doesn't drag them out
+    for (uint16_t n = fadeSteps.advance(dt); n > 0; n--) {
+      if (targetMode) {
+        if (brightness == 0 && targetMode != NONE) {
+          changeModeTo(targetMode);
+          targetMode = NONE;
         }
 
-        // Deal with disabled bounces
-        if (Time.now() >= nextBounceRelease) {
-          for (int i = 0; i < BOUNCE_ARRAY_SIZE; i++) {
-            if (!bounces[i].enabled) {
-              // Survey visible bounces for direction
-              uint8_t forwards = 0;
-              uint8_t backwards = 0;
-              for (uint8_t a = 0; a < BOUNCE_ARRAY_SIZE; a++) {
-                if (bounces[a].enabled) {
-                  if (bounces[a].direction)
-                    forwards++;
-                  else
-                    backwards++;
-                }
-              }
-
-              nextBounceRelease = Time.now() + 2;
-              bounces[i].enabled = true;
-              bounces[i].fadeOut = false;
-
-              if (forwards == 0)
-                bounces[i].direction = true;
-              else if (backwards == 0)
-                bounces[i].direction = false;
-              else
-                bounces[i].direction = random8(0, 2);
-
-              bounces[i].position[0] = bounces[i].direction ? 0 : LED_COUNT-1;
-              for (uint8_t a = 1; a < BOUNCE_LENGTH; a++)
-                bounces[i].position[a] = bounces[i].position[0];
-
-              bounces[i].color = randomBrightColor(true);
-              bounces[i].speed = 20;
-              break;
-            }
-          }
-        }
-        loop_count++;
+        if (brightness > 0)
+          frameDirty = true;
+        uint8_t step = fadeStep(brightness);
+        brightness = brightness > step ? brightness-step : 0;
+      } else if (brightness != targetBrightness) {
+        uint8_t step = fadeStep(brightness);
+        if (targetBrightness > brightness)
+          brightness = targetBrightness - brightness > step ? brightness+step : targetBrightness;
+        else
+          brightness = brightness - targetBrightness > step ? brightness-step : targetBrightness;
+        frameDirty = true;
+      } else {
+        break;
       }
     }
+
+  
+    // We need to continue all animations until
+    // we're powered off and the brightness is 0
+    if ((powerState || brightness > 0) && effect) {
+      uint32_t renderStart = platform->ticks();
+      if (effect->renderFrame(*this, dt))
+        frameDirty = true;
+
+      EffectStats &stats = effectStats[mode];
+      uint32_t ns = (uint64_t)(platform->ticks() - renderStart) * 1000 / platform->ticksPerMicrosecond();
+      stats.frames++;
+      stats.lastNs = ns;
+      stats.totalNs += ns;
+      if (ns > stats.maxNs)
+        stats.maxNs = ns;
+      scheduler.recordRender(ns / 1000);
+      perfCounters[PERF_RENDER].record(platform->ticks() - renderStart);
+    }
   }
 
-  // 20000 == Roughly 60 FPS
-  if ((brightness || lightsOn) && tick_time - lastLedShow >= 20000) {
-    if (brightness == 0)
-      lightsOn = false;
-    else if (!lightsOn)
-      lightsOn = true;
-    lastLedShow = tick_time;
-    FastLED.show();
-    if (showFPS)
-      fps++;
+  // A frame that hasn't changed since the last push is only sent again for
+  // the dithering, and for no more than DITHER_CYCLE_FRAMES, after which it
+  // is left alone. While the strip is still busy with the last frame the
+  // frame stays dirty and the loop goes back to MQTT and rendering rather
+  // than waiting for it.
+  bool ditherDue = ditherPending && ditherFrames < DITHER_CYCLE_FRAMES;
+  if ((brightness || lightsOn) && (frameDirty || ditherDue) && platform->ready() && scheduler.showDue(tick_time)) {
+    // Limited on this frame's own draw, so a jump to white never goes out
+    // over budget even for one frame
+    uint32_t fullPower = platform->framePower(leds, LightLayout::LENGTH);
+    uint8_t shown = powerLimiter.limitFrame(fullPower, brightness);
+    uint32_t showStart = platform->ticks();
+    if (platform->show(leds, LightLayout::LENGTH, shown)) {
+      // Only the show itself, so the scheduler sees wire time apart from
+      // the render it has already been told about
+      uint32_t showTicks = platform->ticks() - showStart;
+      perfCounters[PERF_SHOW].record(showTicks);
+      scheduler.recordShow(showTicks / platform->ticksPerMicrosecond());
+      lightsOn = brightness != 0;
+      powerLimiter.recordFrame(fullPower, shown);
+      ditherFrames = frameDirty ? 0 : ditherFrames + 1;
+      ditherPending = platform->ditherPending();
+      // A ceiling still climbing back needs the frame sent again even if the
+      // effect hasn't changed it
+      frameDirty = powerLimiter.isRecovering();
+      if (showFPS)
+        fps++;
+    }
   }
 
 
-  if (showFPS && Time.now() > nextPublishTime) {
-    Particle.publish("FPS", String::format("%d %d", Time.now(), fps / 10), PRIVATE);
-    nextPublishTime = Time.now() + 10;
+  if (showFPS && platform->now() > nextPublishTime) {
+    char data[24];
+    snprintf(data, sizeof(data), "%lu %d", (unsigned long)platform->now(), fps / 10);
+    platform->publish("FPS", data);
+    nextPublishTime = platform->now() + 10;
     fps = 0;
   }
 }
\ No newline at end of file
@@ -1,15 +1,52 @@
 #ifndef __LIGHT_H_
 #define __LIGHT_H_
 
-#include "Particle.h"
+#include <stdio.h>
+#include <string.h>
 #include "FastLED.h"
+#include "light_platform.h"
+#include "frame_scheduler.h"
+#include "animation_clock.h"
+#include "power_limiter.h"
+#include "settings_journal.h"
+#include "perf_counters.h"
+#include "strip_layout.h"
 #define PARTICLE_NO_ARDUINO_COMPATIBILITY 1
 FASTLED_USING_NAMESPACE
 
-#define LED_COUNT 273
+// 273 pixels round the skylight; Christmas bands converge on pixel 230
+typedef StripLayout<273, 230> LightLayout;
 #define LED_PIN D0
-#define BOUNCE_ARRAY_SIZE 5
-#define BOUNCE_LENGTH 5
+
+// Strips driven in parallel from D0 upwards (at most D0-D4, which share a
+// port). The layout is split into equal runs, one per strip, with the last
+// one padded when it doesn't divide; one strip keeps the DMA output on D0.
+#define LED_LANES 1
+#define LED_LANE_LENGTH ((LightLayout::LENGTH + LED_LANES - 1) / LED_LANES)
+
+// The strip and the Photon share a 5V 8A supply; brightness is capped to
+// keep the estimated draw within it. Full white would take about 57W.
+#define POWER_BUDGET_MW (5 * 8000)
+#define POWER_IDLE_MW (5 * 100)
+
+// Gamma the output driver corrects every byte with as it is sent
+#define LED_GAMMA 2.2f
+
+// An unchanged frame is sent again while the output dithering needs it to
+// average out, but only until every residue has been round once
+#define DITHER_CYCLE_FRAMES 256
+
+// Settings are journalled after the legacy record at address 0, once they
+// have been left alone for SETTINGS_SAVE_DELAY microseconds
+#define SETTINGS_JOURNAL_BASE 16
+#define SETTINGS_JOURNAL_SLOTS 16
+#define SETTINGS_SAVE_DELAY 5000000
+
+#include "effects.h"
+
+struct EffectArena {
+  alignas(8) uint8_t data[effectArenaSize<LightLayout>()];
+};
 
 class Light {
 
@@ -23,7 +60,14 @@ public:
     LIGHT_SWIPE = 5,
     BOUNCE = 6,
   } MODES;
+  struct EffectStats {
+    uint32_t frames;
+    uint32_t lastNs;
+    uint32_t maxNs;
+    uint64_t totalNs;
+  };
   bool showFPS = false;
+  Light(LightPlatform &platform);
   void setup();
   void setMode(MODES newMode);
   MODES getMode();
@@ -34,56 +78,66 @@ public:
   void on();
   void off();
   bool isOn();
-  bool isColorPublished();
   void loadSettings();
   void saveSettings();
   void loop();
   CRGB randomBrightColor(bool includeWhite);
-  
+  CRGB *getLeds();
+  CRGB getTargetColor();
+  uint32_t now();
+  uint32_t animationTime();
+  const EffectStats &getEffectStats(MODES m);
+  void resetEffectStats();
+  void setCpuBudget(uint8_t percent);
+  const FrameScheduler &getScheduler();
+  /// Start the scheduler's peaks and deadline misses over.
+  void resetFrameStats();
+  void setGamma(float gamma);
+  void setPowerBudget(uint32_t mW);
+  const PowerLimiter &getPowerLimiter();
+
 private:
   struct SaveData {
     MODES mode;
     uint8_t brightness;
     CRGB color;
   };
-  struct BounceData {
-    bool enabled = false;
-    bool fadeOut = false;
-    bool direction = true;
-    uint8_t speed = 20;
-    uint16_t position[5];
-    CRGB color = CRGB::White;
-  };
-  CRGB leds[LED_COUNT];
-  uint32_t nextLedCycle;
-  uint16_t loop_count = 0;
+  SettingsJournal settingsJournal{SETTINGS_JOURNAL_BASE, SETTINGS_JOURNAL_SLOTS, sizeof(SaveData)};
+  SaveData savedSettings;
+  bool settingsDirty = false;
+  uint32_t settingsChangedAt = 0;
+  void commitSettings();
+  LightPlatform *platform;
+  EffectStats effectStats[BOUNCE + 1];
+  FrameScheduler scheduler;
+  AnimationClock animationClock;
+  StepCounter fadeSteps;
+  // The strip's dark current doesn't dim with the brightness, so it counts
+  // with the board's
+  PowerLimiter powerLimiter{POWER_BUDGET_MW, POWER_IDLE_MW + calculate_dark_power_mW(LightLayout::LENGTH)};
+  CRGB leds[LED_LANES * LED_LANE_LENGTH];
   bool powerState = false;
-  bool colorPublished = false;
   MODES mode = RAINBOW;
   MODES targetMode = NONE;
 
   // CRGB ledState = CRGB::Black;
   CRGB targetColor = CRGB::Black;
   CRGB savedColor = CRGB::Red;
-  CRGB previousColor = CRGB::Black;
   uint8_t brightness = 0;
   uint8_t savedBrightness = 255;
   uint8_t targetBrightness = 0;
+  bool frameDirty = true;
+  // Whether the last frame sent left fractions for dithering to work off, and
+  // how many times it has been sent again for them
+  bool ditherPending = false;
+  uint16_t ditherFrames = 0;
 
-  CRGB meteorColor[2] = {CRGB::Blue, CRGB::HotPink};
-  uint16_t meteorPosition[2] = {0, 0};
-  uint8_t meteorSpeed[2] = {1, 2};
-  void updateLeds();
-  void addColorToLed(uint16_t p, CRGB c);
-
+  EffectArena effectArena;
+  Effect *effect = NULL;
+  void startEffect(MODES newMode);
   void changeModeTo(MODES newMode);
   uint32_t nextPublishTime;
-  uint32_t lastRuntime;
-  uint32_t lastLedShow;
   uint16_t fps;
-
-  BounceData bounces[BOUNCE_ARRAY_SIZE];
-  uint32_t nextBounceRelease;
   bool lightsOn = false;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef __LIGHT_PLATFORM_H_
+#define __LIGHT_PLATFORM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FastLED.h"
+FASTLED_USING_NAMESPACE
+
+/// Everything Light needs from the runtime it runs on. Light only reaches the
+/// clock, the LED output, settings storage and the cloud through this class.
+/// PhotonPlatform is the firmware's implementation; the host build drives
+/// Light::loop() through SimPlatform, on a virtual clock, capturing every
+/// frame pushed to the strip.
+class LightPlatform {
+public:
+  virtual ~LightPlatform() {}
+
+  /// Register the frame buffer with the output driver.
+  virtual void begin(CRGB *leds, uint16_t count) = 0;
+
+  /// Monotonic microsecond clock used for animation timing.
+  virtual uint32_t micros() = 0;
+
+  /// Free running tick counter used for profiling.
+  virtual uint32_t ticks() = 0;
+  virtual uint32_t ticksPerMicrosecond() = 0;
+
+  /// Wall clock in seconds.
+  virtual uint32_t now() = 0;
+
+  /// Whether show() can push a frame now, without waiting on the refresh
+  /// cap or for the previous frame to finish going out.
+  virtual bool ready() = 0;
+
+  /// Gamma correct the output. Applied by the driver as it sends each byte,
+  /// so leds[] stays linear and no extra pass is needed.
+  virtual void setGamma(float gamma) = 0;
+
+  /// Push the frame buffer to the strip at the given global brightness.
+  /// Never waits: returns false, leaving the strip as it was, if the output
+  /// wasn't ready.
+  virtual bool show(const CRGB *leds, uint16_t count, uint8_t brightness) = 0;
+
+  /// Whether the frame just shown has to be shown again for the output
+  /// dithering to average out to the right values.
+  virtual bool ditherPending() = 0;
+
+  /// Draw in mW the frame's colours would add at full brightness, gamma
+  /// included, over what the leds take when dark. Light asks before showing
+  /// it, so a frame is limited on its own draw.
+  virtual uint32_t framePower(const CRGB *leds, uint16_t count) = 0;
+
+  virtual void readSettings(int address, void *data, size_t length) = 0;
+  virtual void writeSettings(int address, const void *data, size_t length) = 0;
+
+  virtual void publish(const char *name, const char *data) = 0;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "mqtt.h"
+#include "perf_counters.h"
 
 #define LOGGING
 
@@ -48,11 +49,16 @@ MQTT::~MQTT() {
 
     if (buffer != NULL)
       delete[] buffer;
+    if (rxBuffer != NULL)
+      delete[] rxBuffer;
+    if (outBuffer != NULL)
+      delete[] outBuffer;
 }
 
 void MQTT::initialize(char* domain, uint8_t *ip, uint16_t port, int keepalive, void (*callback)(char*,uint8_t*,unsigned int), int maxpacketsize) {
     this->callback = callback;
     this->qoscallback = NULL;
+    this->connectcallback = NULL;
     if (ip != NULL)
         this->ip = ip;
     if (domain != NULL)
@@ -65,6 +71,15 @@ void MQTT::initialize(char* domain, uint8_t *ip, uint16_t port, int keepalive, v
     if (buffer != NULL)
       delete[] buffer;
     buffer = new uint8_t[this->maxpacketsize];
+    if (rxBuffer != NULL)
+      delete[] rxBuffer;
+    rxBuffer = new uint8_t[this->maxpacketsize];
+    if (outBuffer == NULL)
+      outBuffer = new uint8_t[MQTT_OUT_BUFFER_SIZE];
+    outHead = outCount = 0;
+    publishCount = bytesCopied = 0;
+    connectCount = 0;
+    resetParser();
 }
 
 void MQTT::setBroker(char* domain, uint16_t port) {
@@ -90,6 +105,11 @@ void MQTT::addQosCallback(void (*qoscallback)(unsigned int)) {
     this->qoscallback = qoscallback;
 }
 
+// Called from loop() once the broker has accepted the connection
+void MQTT::addConnectCallback(void (*connectcallback)(void)) {
+    this->connectcallback = connectcallback;
+}
+
 
 bool MQTT::connect(const char *id) {
     return connect(id, NULL, NULL, 0, QOS0, 0, 0, true);
@@ -100,7 +120,7 @@ bool MQTT::connect(const char *id, const char *user, const char *pass) {
 }
 
 bool MQTT::connect(const char *id, const char *user, const char *pass, const char* willTopic, EMQTT_QOS willQos, uint8_t willRetain, const char* willMessage, bool cleanSession, MQTT_VERSION version) {
-    if (!isConnected()) {
+    if (!isConnected() && !isConnecting()) {
         int result = 0;
         if (ip == NULL)
             result = _client.connect(this->domain.c_str(), this->port);
@@ -157,183 +177,217 @@ bool MQTT::connect(const char *id, const char *user, const char *pass, const cha
                 }
             }
 
-            write(MQTTCONNECT, buffer, length-5);
+            outHead = outCount = 0;
+            resetParser();
+            state = MQTT_CONNECTING;
             lastInActivity = lastOutActivity = millis();
 
-            while (!_client.available()) {
-                unsigned long t = millis();
-                if (t-lastInActivity > this->keepalive*1000UL) {
-                    _client.stop();
-                    return false;
-                }
-            }
-            uint8_t llen;
-            uint16_t len = readPacket(&llen);
-
-            if (len == 4) {
-                if (buffer[3] == CONN_ACCEPT) {
-                    lastInActivity = millis();
-                    pingOutstanding = false;
-                    debug_print(" Connect success\n");
-                    return true;
-                } else {
-                    // check EMQTT_CONNACK_RESPONSE code.
-                    debug_print(" Connect fail. code = [%d]\n", buffer[3]);
-                }
-            }
+            // The CONNACK is picked up by loop()
+            if (write(MQTTCONNECT, buffer, length-5))
+                return true;
         }
-        _client.stop();
+        closeSession();
     }
     return false;
 }
 
-uint8_t MQTT::readByte() {
-    while(!_client.available()) {}
-    return _client.read();
+void MQTT::resetParser() {
+    rxState = RX_HEADER;
+    rxLen = 0;
+}
+
+// Feed one received byte to the parser. Returns true when a whole packet is
+// in rxBuffer. Packets too big for the buffer are read and dropped.
+bool MQTT::parseByte(uint8_t b) {
+    switch (rxState) {
+    case RX_HEADER:
+        rxBuffer[0] = b;
+        rxLen = 1;
+        rxRemaining = 0;
+        rxMultiplier = 1;
+        rxState = RX_LENGTH;
+        return false;
+
+    case RX_LENGTH:
+        rxBuffer[rxLen++] = b;
+        rxRemaining += (b & 127) * rxMultiplier;
+        rxMultiplier *= 128;
+        if (b & 128) {
+            if (rxLen > 4) // more than 4 length bytes is malformed
+                closeSession();
+            return false;
+        }
+        rxLengthLength = rxLen-1;
+        if (rxRemaining > 0) {
+            rxState = RX_BODY;
+            return false;
+        }
+        rxState = RX_HEADER;
+        return true;
+
+    case RX_BODY:
+        if (rxLen < this->maxpacketsize)
+            rxBuffer[rxLen] = b;
+        rxLen++;
+        if (--rxRemaining > 0)
+            return false;
+        rxState = RX_HEADER;
+        return rxLen <= this->maxpacketsize;
+    }
+    return false;
 }
 
-uint16_t MQTT::readPacket(uint8_t* lengthLength) {
-    uint16_t len = 0;
-    buffer[len++] = readByte();
-    bool isPublish = (buffer[0]&0xF0) == MQTTPUBLISH;
-    uint32_t multiplier = 1;
-    uint16_t length = 0;
-    uint8_t digit = 0;
-    uint16_t skip = 0;
-    uint8_t start = 0;
+bool MQTT::loop() {
+    if (!isConnected() && !isConnecting())
+        return false;
 
-    do {
-        digit = readByte();
-        buffer[len++] = digit;
-        length += (digit & 127) * multiplier;
-        multiplier *= 128;
-    } while ((digit & 128) != 0);
-    *lengthLength = len-1;
-
-    if (isPublish) {
-        // Read in topic length to calculate bytes to skip over for Stream writing
-        buffer[len++] = readByte();
-        buffer[len++] = readByte();
-        skip = (buffer[*lengthLength+1]<<8)+buffer[*lengthLength+2];
-        start = 2;
-        if (buffer[0] & MQTTQOS1_HEADER_MASK) {
-            // skip message id
-            skip += 2;
+    PerfScope scope(PERF_MQTT_LOOP);
+
+    unsigned long t = millis();
+    if (state == MQTT_CONNECTING) {
+        if (t - lastInActivity > this->keepalive*1000UL) {
+            debug_print(" Connect timeout\n");
+            closeSession();
+            return false;
+        }
+    } else if ((t - lastInActivity > this->keepalive*1000UL) || (t - lastOutActivity > this->keepalive*1000UL)) {
+        if (pingOutstanding) {
+            closeSession();
+            return false;
+        } else {
+            const uint8_t ping[] = {MQTTPINGREQ, 0};
+            enqueue(ping, sizeof(ping));
+            lastOutActivity = t;
+            lastInActivity = t;
+            pingOutstanding = true;
         }
     }
 
-    for (uint16_t i = start;i<length;i++) {
-        digit = readByte();
-        if (len < this->maxpacketsize) {
-            buffer[len] = digit;
+    // Only take what has already arrived, never wait for more. The parse
+    // counter gets a sample per loop() that read anything, leaving out the
+    // time spent handling complete packets (and so the user callback).
+    uint32_t parseCycles = 0;
+    bool parsed = false;
+    uint32_t parseStart = perfCycles();
+    for (int available = _client.available(); available > 0 && state != MQTT_DISCONNECTED; available--) {
+        int c = _client.read();
+        if (c < 0)
+            break;
+        parsed = true;
+        if (parseByte(c)) {
+            lastInActivity = t;
+            parseCycles += perfCycles() - parseStart;
+            handlePacket(rxLen, rxLengthLength);
+            parseStart = perfCycles();
         }
-        len++;
     }
-
-    if (len > this->maxpacketsize) {
-        len = 0; // This will cause the packet to be ignored.
+    if (parsed)
+        perfCounters[PERF_MQTT_PARSE].record(parseCycles + perfCycles() - parseStart);
+
+    flush();
+    return state != MQTT_DISCONNECTED;
+}
+
+void MQTT::handlePacket(uint16_t len, uint8_t llen) {
+    uint8_t *buffer = rxBuffer;
+    uint16_t msgId = 0;
+    uint8_t *payload;
+    uint8_t type = buffer[0]&0xF0;
+
+    if (state == MQTT_CONNECTING) {
+        if (type == MQTTCONNACK && len == 4 && buffer[3] == CONN_ACCEPT) {
+            state = MQTT_CONNECTED;
+            pingOutstanding = false;
+            connectCount++;
+            debug_print(" Connect success\n");
+            if (connectcallback)
+                connectcallback();
+        } else {
+            // check EMQTT_CONNACK_RESPONSE code.
+            debug_print(" Connect fail. code = [%d]\n", buffer[3]);
+            closeSession();
+        }
+        return;
     }
 
-    return len;
-}
-
-bool MQTT::loop() {
-    if (isConnected()) {
-        unsigned long t = millis();
-        if ((t - lastInActivity > this->keepalive*1000UL) || (t - lastOutActivity > this->keepalive*1000UL)) {
-            if (pingOutstanding) {
-                _client.stop();
-                return false;
+    if (type == MQTTPUBLISH) {
+        // The topic length comes off the wire, so it (and the msgId after
+        // it for QoS>0) has to fit in what was actually received
+        uint16_t header = llen+3;
+        if (header > len) {
+            closeSession();
+            return;
+        }
+        uint16_t tl = (buffer[llen+1]<<8)+buffer[llen+2]; // topic length
+        if (header + tl + ((buffer[0]&0x06) ? 2 : 0) > len) {
+            debug_print(" Malformed PUBLISH\n");
+            closeSession();
+            return;
+        }
+        if (callback) {
+            // Messages on topics too long for the buffer are still
+            // acknowledged, just not handed on
+            char topic[MQTT_MAX_TOPIC_LENGTH+1];
+            bool deliver = tl <= MQTT_MAX_TOPIC_LENGTH;
+            if (deliver) {
+                memcpy(topic, buffer+header, tl);
+                topic[tl] = 0;
             } else {
-                buffer[0] = MQTTPINGREQ;
-                buffer[1] = 0;
-                _client.write(buffer,2);
-                lastOutActivity = t;
-                lastInActivity = t;
-                pingOutstanding = true;
+                debug_print(" Topic too long, dropped\n");
+            }
+            // msgId only present for QOS>0
+            if ((buffer[0]&0x06) == MQTTQOS1_HEADER_MASK) { // QoS=1
+                msgId = (buffer[llen+3+tl]<<8)+buffer[llen+3+tl+1];
+                payload = buffer+llen+3+tl+2;
+                if (deliver)
+                    callback(topic,payload,len-llen-3-tl-2);
+
+                const uint8_t ack[] = {MQTTPUBACK, 2, (uint8_t)(msgId >> 8), (uint8_t)(msgId & 0xFF)}; // respond with PUBACK
+                enqueue(ack, sizeof(ack));
+            } else if ((buffer[0] & 0x06) == MQTTQOS2_HEADER_MASK) { // QoS=2
+                msgId = (buffer[llen + 3 + tl] << 8) + buffer[llen + 3 + tl + 1];
+                payload = buffer + llen + 3 + tl + 2;
+                if (deliver)
+                    callback(topic, payload, len - llen - 3 - tl - 2);
+
+                const uint8_t rec[] = {MQTTPUBREC, 2, (uint8_t)(msgId >> 8), (uint8_t)(msgId & 0xFF)}; // respond with PUBREC
+                enqueue(rec, sizeof(rec));
+            } else if (deliver) {
+                payload = buffer+llen+3+tl;
+                callback(topic,payload,len-llen-3-tl);
             }
         }
-        if (_client.available()) {
-            uint8_t llen;
-            uint16_t len = readPacket(&llen);
-            uint16_t msgId = 0;
-            uint8_t *payload;
-            if (len > 0) {
-                lastInActivity = t;
-                uint8_t type = buffer[0]&0xF0;
-                if (type == MQTTPUBLISH) {
-                    if (callback) {
-                        uint16_t tl = (buffer[llen+1]<<8)+buffer[llen+2]; // topic length
-                        char topic[tl+1];
-                        for (uint16_t i=0;i<tl;i++) {
-                            topic[i] = buffer[llen+3+i];
-                        }
-                        topic[tl] = 0;
-                        // msgId only present for QOS>0
-                        if ((buffer[0]&0x06) == MQTTQOS1_HEADER_MASK) { // QoS=1
-                            msgId = (buffer[llen+3+tl]<<8)+buffer[llen+3+tl+1];
-                            payload = buffer+llen+3+tl+2;
-                            callback(topic,payload,len-llen-3-tl-2);
-
-                            buffer[0] = MQTTPUBACK; // respond with PUBACK
-                            buffer[1] = 2;
-                            buffer[2] = (msgId >> 8);
-                            buffer[3] = (msgId & 0xFF);
-                            _client.write(buffer,4);
-                            lastOutActivity = t;
-        						    } else if ((buffer[0] & 0x06) == MQTTQOS2_HEADER_MASK) { // QoS=2
-							              msgId = (buffer[llen + 3 + tl] << 8) + buffer[llen + 3 + tl + 1];
-							              payload = buffer + llen + 3 + tl + 2;
-							              callback(topic, payload, len - llen - 3 - tl - 2);
-
-              							buffer[0] = MQTTPUBREC; // respond with PUBREC
-              							buffer[1] = 2;
-              							buffer[2] = (msgId >> 8);
-              							buffer[3] = (msgId & 0xFF);
-              							_client.write(buffer, 4);
-              							lastOutActivity = t;
-            						} else {
-                            payload = buffer+llen+3+tl;
-                            callback(topic,payload,len-llen-3-tl);
-                        }
-                    }
-                } else if (type == MQTTPUBREC) {
-                    // check for the situation that QoS2 receive PUBREC, should return PUBREL
-                    msgId = (buffer[2] << 8) + buffer[3];
-                    this->publishRelease(msgId);
-                } else if (type == MQTTPUBACK) {
-                    if (qoscallback) {
-                        // this case QOS==1
-                        if (len == 4 && (buffer[0]&0x06) == MQTTQOS0_HEADER_MASK) {
-                            msgId = (buffer[2]<<8)+buffer[3];
-                            this->qoscallback(msgId);
-                        }
-                    }
-                } else if (type == MQTTPUBREL) {
-                  msgId = (buffer[2] << 8) + buffer[3];
-                  this->publishComplete(msgId);
-                } else if (type == MQTTPUBCOMP) {
-                  if (qoscallback) {
-                      // msgId only present for QOS==0
-                      if (len == 4 && (buffer[0]&0x06) == MQTTQOS0_HEADER_MASK) {
-                          msgId = (buffer[2]<<8)+buffer[3];
-                          this->qoscallback(msgId);
-                      }
-                  }
-                } else if (type == MQTTSUBACK) {
-                    // if something...
-                } else if (type == MQTTPINGREQ) {
-                    buffer[0] = MQTTPINGRESP;
-                    buffer[1] = 0;
-                    _client.write(buffer,2);
-                } else if (type == MQTTPINGRESP) {
-                    pingOutstanding = false;
-                }
+    } else if (type == MQTTPUBREC) {
+        // check for the situation that QoS2 receive PUBREC, should return PUBREL
+        msgId = (buffer[2] << 8) + buffer[3];
+        this->publishRelease(msgId);
+    } else if (type == MQTTPUBACK) {
+        if (qoscallback) {
+            // this case QOS==1
+            if (len == 4 && (buffer[0]&0x06) == MQTTQOS0_HEADER_MASK) {
+                msgId = (buffer[2]<<8)+buffer[3];
+                this->qoscallback(msgId);
             }
         }
-        return true;
+    } else if (type == MQTTPUBREL) {
+        msgId = (buffer[2] << 8) + buffer[3];
+        this->publishComplete(msgId);
+    } else if (type == MQTTPUBCOMP) {
+        if (qoscallback) {
+            // msgId only present for QOS==0
+            if (len == 4 && (buffer[0]&0x06) == MQTTQOS0_HEADER_MASK) {
+                msgId = (buffer[2]<<8)+buffer[3];
+                this->qoscallback(msgId);
+            }
+        }
+    } else if (type == MQTTSUBACK) {
+        // if something...
+    } else if (type == MQTTPINGREQ) {
+        const uint8_t pong[] = {MQTTPINGRESP, 0};
+        enqueue(pong, sizeof(pong));
+    } else if (type == MQTTPINGRESP) {
+        pingOutstanding = false;
     }
-    return false;
 }
 
 bool MQTT::publish(const char* topic, const char* payload) {
@@ -373,25 +427,19 @@ bool MQTT::publish(const char* topic, const uint8_t* payload, unsigned int pleng
 }
 
 bool MQTT::publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retain, EMQTT_QOS qos, bool dup, uint16_t *messageid) {
-    if (isConnected()) {
-        // Leave room in the buffer for header and variable length field
-        uint16_t length = 5;
-        memset(buffer, 0, this->maxpacketsize);
-
-        length = writeString(topic, buffer, length);
+    if (isConnected() && plength <= MQTT_OUT_BUFFER_SIZE) {
+        uint16_t topicLength = strlen(topic);
+        uint8_t msgId[2];
+        uint8_t msgIdLength = 0;
 
         if (qos == QOS2 || qos == QOS1) {
             nextMsgId += 1;
-            buffer[length++] = (nextMsgId >> 8);
-            buffer[length++] = (nextMsgId & 0xFF);
+            msgId[msgIdLength++] = (nextMsgId >> 8);
+            msgId[msgIdLength++] = (nextMsgId & 0xFF);
             if (messageid != NULL)
                 *messageid = nextMsgId++;
         }
 
-        for (uint16_t i=0; i < plength && length < this->maxpacketsize; i++) {
-            buffer[length++] = payload[i];
-        }
-
         uint8_t header = MQTTPUBLISH;
         if (retain) {
             header |= 1;
@@ -408,7 +456,23 @@ bool MQTT::publish(const char* topic, const uint8_t* payload, unsigned int pleng
         else
             header |= MQTTQOS0_HEADER_MASK;
 
-        return write(header, buffer, length-5);
+        // Fixed header, remaining length and topic length are the only bytes
+        // assembled here; topic and payload go out from the caller's memory.
+        uint8_t head[7];
+        uint8_t headLength = encodeHeader(header, 2 + topicLength + msgIdLength + plength, head);
+        head[headLength++] = (topicLength >> 8);
+        head[headLength++] = (topicLength & 0xFF);
+
+        const Segment segments[] = {
+            {head, headLength},
+            {(const uint8_t*)topic, topicLength},
+            {msgId, msgIdLength},
+            {payload, (uint16_t)plength}
+        };
+        if (send(segments, sizeof(segments) / sizeof(segments[0]))) {
+            publishCount++;
+            return true;
+        }
     }
     return false;
 }
@@ -421,7 +485,7 @@ bool MQTT::publishRelease(uint16_t messageid) {
         buffer[length++] = 2;
         buffer[length++] = (messageid >> 8);
         buffer[length++] = (messageid & 0xFF);
-        return _client.write(buffer, length);
+        return enqueue(buffer, length);
     }
     return false;
 }
@@ -434,36 +498,94 @@ bool MQTT::publishComplete(uint16_t messageid) {
         buffer[length++] = 2;
         buffer[length++] = (messageid >> 8);
         buffer[length++] = (messageid & 0xFF);
-        return _client.write(buffer, length);
+        return enqueue(buffer, length);
     }
     return false;
 }
 
 bool MQTT::write(uint8_t header, uint8_t* buf, uint16_t length) {
-    uint8_t lenBuf[4];
-    uint8_t llen = 0;
-    uint8_t digit;
+    uint8_t head[5];
+    uint8_t headLength = encodeHeader(header, length, head);
+    memcpy(buf+5-headLength, head, headLength);
+    return enqueue(buf+5-headLength, length+headLength);
+}
+
+// Write the fixed header and remaining length into out, returning its size
+uint8_t MQTT::encodeHeader(uint8_t header, uint32_t length, uint8_t* out) {
     uint8_t pos = 0;
-    uint16_t rc;
-    uint16_t len = length;
+    out[pos++] = header;
     do {
-        digit = len % 128;
-        len = len / 128;
-        if (len > 0) {
+        uint8_t digit = length % 128;
+        length = length / 128;
+        if (length > 0) {
             digit |= 0x80;
         }
-        lenBuf[pos++] = digit;
-        llen++;
-    } while(len > 0);
+        out[pos++] = digit;
+    } while (length > 0);
+    return pos;
+}
 
-    buf[4-llen] = header;
-    for (int i = 0; i < llen; i++) {
-        buf[5-llen+i] = lenBuf[i];
-    }
-    rc = _client.write(buf+(4-llen), length+1+llen);
+bool MQTT::enqueue(const uint8_t* data, uint16_t length) {
+    const Segment segment = {data, length};
+    return send(&segment, 1);
+}
+
+// Send a whole packet made of segments, or nothing if it doesn't fit. While
+// nothing is queued ahead of it the packet goes straight to the socket, and
+// only what the socket won't take yet is copied into the ring.
+bool MQTT::send(const Segment* segments, uint8_t count) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < count; i++)
+        total += segments[i].length;
+    if (total > (uint32_t)(MQTT_OUT_BUFFER_SIZE - outCount))
+        return false;
 
-    lastOutActivity = millis();
-    return (rc == 1+llen+length);
+    for (uint8_t i = 0; i < count; i++) {
+        const uint8_t* data = segments[i].data;
+        uint16_t length = segments[i].length;
+
+        if (outCount == 0 && length > 0) {
+            int rc = (int)_client.write(data, length, 0);
+            if (rc > 0) {
+                data += rc;
+                length -= rc;
+                lastOutActivity = millis();
+            }
+        }
+
+        if (length == 0)
+            continue;
+
+        uint16_t first = MQTT_OUT_BUFFER_SIZE - outHead;
+        if (first > length)
+            first = length;
+        memcpy(outBuffer + outHead, data, first);
+        memcpy(outBuffer, data + first, length - first);
+        outHead = (outHead + length) % MQTT_OUT_BUFFER_SIZE;
+        outCount += length;
+        bytesCopied += length;
+    }
+    return true;
+}
+
+// Hand the socket as much of the ring as it will take, waiting up to timeout
+// milliseconds per write for room (never, by default)
+void MQTT::flush(system_tick_t timeout) {
+    while (outCount > 0) {
+        uint16_t tail = (outHead + MQTT_OUT_BUFFER_SIZE - outCount) % MQTT_OUT_BUFFER_SIZE;
+        uint16_t chunk = MQTT_OUT_BUFFER_SIZE - tail;
+        if (chunk > outCount)
+            chunk = outCount;
+
+        int rc = (int)_client.write(outBuffer + tail, chunk, timeout);
+        if (rc <= 0)
+            return;
+
+        outCount -= rc;
+        lastOutActivity = millis();
+        if (rc < chunk)
+            return;
+    }
 }
 
 bool MQTT::subscribe(const char* topic) {
@@ -503,11 +625,21 @@ bool MQTT::unsubscribe(const char* topic) {
     return false;
 }
 
+// Closing the session empties the ring, so DISCONNECT and anything queued
+// ahead of it have to reach the socket first
 void MQTT::disconnect() {
-    buffer[0] = MQTTDISCONNECT;
-    buffer[1] = 0;
-    _client.write(buffer,2);
+    const uint8_t packet[] = {MQTTDISCONNECT, 0};
+    flush(MQTT_DISCONNECT_TIMEOUT);
+    if (enqueue(packet, sizeof(packet)))
+        flush(MQTT_DISCONNECT_TIMEOUT);
+    closeSession();
+}
+
+void MQTT::closeSession() {
     _client.stop();
+    state = MQTT_DISCONNECTED;
+    outHead = outCount = 0;
+    resetParser();
     lastInActivity = lastOutActivity = millis();
 }
 
@@ -526,12 +658,20 @@ uint16_t MQTT::writeString(const char* string, uint8_t* buf, uint16_t pos) {
 
 
 bool MQTT::isConnected() {
-    bool rc = (int)_client.connected();
-    if (!rc) _client.stop();
-    return rc;
+    if (!_client.connected()) {
+        if (state != MQTT_DISCONNECTED)
+            closeSession();
+        else
+            _client.stop();
+        return false;
+    }
+    return state == MQTT_CONNECTED;
+}
+
+bool MQTT::isConnecting() {
+    return state == MQTT_CONNECTING && _client.connected();
 }
 
 void MQTT::clear() {
-  _client.stop();
-  lastInActivity = lastOutActivity = millis();
+  closeSession();
 }
\ No newline at end of file
@@ -71,6 +71,18 @@ bug fixed and features pull requests
 // this size is total of [MQTT Header(Max:5byte) + Topic Name Length + Topic Name + Message ID(QoS1|2) + Payload]
 #define MQTT_MAX_PACKET_SIZE 255
 
+// MQTT_MAX_TOPIC_LENGTH : Longest topic handed to the callback. Messages received on longer topics are
+// acknowledged and dropped.
+#define MQTT_MAX_TOPIC_LENGTH 128
+
+// MQTT_OUT_BUFFER_SIZE : Outbound ring buffer size. Packets are queued here and sent from loop(), so this is
+// the most that can be published between two loop() calls.
+#define MQTT_OUT_BUFFER_SIZE 1024
+
+// MQTT_DISCONNECT_TIMEOUT : Milliseconds disconnect() may wait for the socket to take what is queued ahead of
+// DISCONNECT
+#define MQTT_DISCONNECT_TIMEOUT 100
+
 // MQTT_KEEPALIVE : keepAlive interval in Seconds
 #define MQTT_DEFAULT_KEEPALIVE 15
 
@@ -115,6 +127,12 @@ typedef enum{
     MQTT_V311 = 4
 } MQTT_VERSION;
 
+typedef enum {
+    MQTT_DISCONNECTED = 0,
+    MQTT_CONNECTING = 1,
+    MQTT_CONNECTED = 2
+} EMQTT_STATE;
+
 typedef enum {
     CONN_ACCEPT = 0,
     CONN_UNACCEPTABLE_PROCOTOL = 1,
@@ -131,11 +149,46 @@ private:
     unsigned long lastOutActivity;
     unsigned long lastInActivity;
     bool pingOutstanding;
+    EMQTT_STATE state = MQTT_DISCONNECTED;
     void (*callback)(char*,uint8_t*,unsigned int);
     void (*qoscallback)(unsigned int);
-    uint16_t readPacket(uint8_t*);
-    uint8_t readByte();
+    void (*connectcallback)(void);
+
+    // Inbound packet parser. Bytes are fed in as they arrive, so a packet may
+    // take several loop() calls to complete.
+    typedef enum {
+        RX_HEADER,
+        RX_LENGTH,
+        RX_BODY
+    } ERX_STATE;
+    uint8_t *rxBuffer = NULL;
+    ERX_STATE rxState;
+    uint32_t rxLen;
+    uint32_t rxRemaining;
+    uint32_t rxMultiplier;
+    uint8_t rxLengthLength;
+    bool parseByte(uint8_t b);
+    void resetParser();
+    void handlePacket(uint16_t len, uint8_t llen);
+
+    // Outbound ring buffer, drained by flush()
+    struct Segment {
+        const uint8_t* data;
+        uint16_t length;
+    };
+    uint8_t *outBuffer = NULL;
+    uint16_t outHead;
+    uint16_t outCount;
+    uint32_t publishCount;
+    uint32_t bytesCopied;
+    uint32_t connectCount;
+    bool enqueue(const uint8_t* data, uint16_t length);
+    bool send(const Segment* segments, uint8_t count);
+    void flush(system_tick_t timeout = 0);
+    void closeSession();
+
     bool write(uint8_t header, uint8_t* buf, uint16_t length);
+    uint8_t encodeHeader(uint8_t header, uint32_t length, uint8_t* out);
     uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos);
     String domain;
     uint8_t *ip = NULL;
@@ -171,6 +224,8 @@ public:
     void setBroker(char* domain, uint16_t port);
     void setBroker(uint8_t *ip, uint16_t port);
 
+    // connect() only opens the socket and queues CONNECT. The session is up
+    // once loop() has received the CONNACK, which calls the connect callback.
     bool connect(const char *id);
     bool connect(const char *id, const char *user, const char *pass);
     bool connect(const char *id, const char *user, const char *pass, const char* willTopic, EMQTT_QOS willQos, uint8_t willRetain, const char* willMessage, bool cleanSession, MQTT_VERSION version = MQTT_V311);
@@ -188,12 +243,22 @@ public:
     bool publish(const char *topic, const uint8_t *payload, unsigned int plength, bool retain, EMQTT_QOS qos, uint16_t *messageid = NULL);
     bool publish(const char *topic, const uint8_t *payload, unsigned int plength, bool retain, EMQTT_QOS qos, bool dup, uint16_t *messageid);
     void addQosCallback(void (*qoscallback)(unsigned int));
+    void addConnectCallback(void (*connectcallback)(void));
 
     bool subscribe(const char *topic);
     bool subscribe(const char *topic, EMQTT_QOS);
     bool unsubscribe(const char *topic);
     bool loop();
     bool isConnected();
+    bool isConnecting();
+
+    // Publishes sent, and bytes that had to be copied into the outbound ring
+    // because the socket wasn't ready for them
+    uint32_t getPublishCount() { return publishCount; }
+    uint32_t getBytesCopied() { return bytesCopied; }
+    // Sessions established, and bytes waiting in the outbound ring
+    uint32_t getConnectCount() { return connectCount; }
+    uint16_t getQueuedBytes() { return outCount; }
 };
 
 #endif  // __MQTT_H_
\ No newline at end of file
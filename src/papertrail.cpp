@@ -1,12 +1,28 @@
+#include <stdarg.h>
+#include <time.h>
 #include "papertrail.h"
 
 ///Local port to be used by the socket.
 const uint16_t PapertrailLogHandler::kLocalPort = 8888;
 
 PapertrailLogHandler::PapertrailLogHandler(String host, uint16_t port, String app, String system, LogLevel level,
-    const LogCategoryFilters &filters) : LogHandler(level, filters), m_host(host), m_port(port), m_app(app),
-                                         m_system(system)  {
+    const LogCategoryFilters &filters) : LogHandler(level, filters), m_port(port)  {
     m_inited = false;
+    strncpy(m_host, host.c_str(), sizeof(m_host) - 1);
+    m_host[sizeof(m_host) - 1] = '\0';
+
+    // Everything after the timestamp is the same for every line
+    snprintf(m_header, sizeof(m_header), "%s %s - - - ", system.c_str(), app.c_str());
+
+    for (int i = 0; i < PAPERTRAIL_RING_LINES; i++) {
+        m_lines[i].state = LINE_FREE;
+    }
+    m_head = m_tail = m_pending = 0;
+    m_dropped = m_droppedTotal = 0;
+    m_lastFlush = 0;
+    m_timeCached = 0;
+    m_time[0] = '\0';
+
     LogManager::instance()->addHandler(this);
 }
 
@@ -20,15 +36,88 @@ IPAddress PapertrailLogHandler::resolve(const char *host) {
 #endif
 }
 
-/// Send the log message to Papertrail.
-void PapertrailLogHandler::log(String message) {
-    String time = Time.format(Time.now(), TIME_FORMAT_ISO8601_FULL);
-    String packet = String::format("<22>1 %s %s %s - - - %s", time.c_str(), m_system.c_str(), m_app.c_str(),
-                                   message.c_str());
-    int ret = m_udp.sendPacket(packet, packet.length(), m_address, m_port);
+/// Send lines from the ring, packing as many as fit into each datagram. Stops at the first line still being
+/// written so lines always go out in order.
+void PapertrailLogHandler::flush() {
+    size_t length = 0;
+    uint32_t dropped;
+
+    ATOMIC_BLOCK() {
+        dropped = m_dropped;
+        m_dropped = 0;
+        m_droppedTotal += dropped;
+    }
+
+    if (dropped) {
+        length = snprintf(m_packet, sizeof(m_packet), "<20>1 %s %s%lu log lines dropped\n", timestamp(), m_header,
+                          (unsigned long)dropped);
+    }
+
+    while (m_lines[m_tail].state == LINE_READY) {
+        Line &line = m_lines[m_tail];
+
+        if (length + line.length + 1 > sizeof(m_packet)) {
+            if (!send(length)) {
+                return;
+            }
+            length = 0;
+        }
+
+        memcpy(m_packet + length, line.text, line.length);
+        length += line.length;
+        m_packet[length++] = '\n';
+
+        ATOMIC_BLOCK() {
+            line.state = LINE_FREE;
+            m_tail = (m_tail + 1) % PAPERTRAIL_RING_LINES;
+            m_pending--;
+        }
+    }
+
+    if (length > 0) {
+        send(length);
+    }
+}
+
+bool PapertrailLogHandler::send(size_t length) {
+    int ret = m_udp.sendPacket((const uint8_t *)m_packet, length, m_address, m_port);
     if (ret < 1) {
         m_inited = false;
+        return false;
     }
+    return true;
+}
+
+void PapertrailLogHandler::loop() {
+    if (m_pending == 0 && m_dropped == 0) {
+        return;
+    }
+
+    if (millis() - m_lastFlush < PAPERTRAIL_FLUSH_INTERVAL && m_pending < PAPERTRAIL_RING_LINES / 2) {
+        return;
+    }
+
+    m_lastFlush = millis();
+    if (lazyInit()) {
+        flush();
+    }
+}
+
+/// Timestamp for the current second, only reformatted when the second changes.
+const char* PapertrailLogHandler::timestamp() {
+    time_t now = Time.now();
+    if (now != m_timeCached) {
+        char time[sizeof(m_time)];
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        strftime(time, sizeof(time), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+        ATOMIC_BLOCK() {
+            memcpy(m_time, time, sizeof(m_time));
+            m_timeCached = now;
+        }
+    }
+    return m_time;
 }
 
 PapertrailLogHandler::~PapertrailLogHandler() {
@@ -80,68 +169,90 @@ const char* PapertrailLogHandler::extractFuncName(const char *s, size_t *size) {
     return s1;
 }
 
+// Append formatted text to a line, truncating at the end of the buffer
+static size_t appendf(char *buf, size_t pos, size_t size, const char *fmt, ...) {
+    if (pos >= size - 1) {
+        return pos;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + pos, size - pos, fmt, args);
+    va_end(args);
+
+    if (n < 0) {
+        return pos;
+    }
+    pos += n;
+    return pos < size - 1 ? pos : size - 1;
+}
+
 void PapertrailLogHandler::logMessage(const char *msg, LogLevel level, const char *category, const LogAttributes &attr) {
-    if (!lazyInit()) {
-      return;
+    // Claim a slot; the formatting happens outside the critical section
+    uint8_t index;
+    ATOMIC_BLOCK() {
+        index = m_head;
+        if (m_lines[index].state != LINE_FREE) {
+            m_dropped++;
+            return;
+        }
+        m_lines[index].state = LINE_WRITING;
+        m_head = (m_head + 1) % PAPERTRAIL_RING_LINES;
     }
 
-    String s;
+    Line &line = m_lines[index];
+    char *s = line.text;
+    const size_t size = sizeof(line.text);
+    size_t pos = appendf(s, 0, size, "<22>1 %s %s", timestamp(), m_header);
 
     if (category) {
-        s.concat("[");
-        s.concat(category);
-        s.concat("] ");
+        pos = appendf(s, pos, size, "[%s] ", category);
     }
 
     // Source file
     if (attr.has_file) {
-        s = extractFileName(attr.file); // Strip directory path
-        s.concat(s); // File name
+        pos = appendf(s, pos, size, "%s", extractFileName(attr.file)); // Strip directory path
         if (attr.has_line) {
-            s.concat(":");
-            s.concat(String(attr.line)); // Line number
-        }
-        if (attr.has_function) {
-            s.concat(", ");
-        } else {
-            s.concat(": ");
+            pos = appendf(s, pos, size, ":%d", attr.line); // Line number
         }
+        pos = appendf(s, pos, size, attr.has_function ? ", " : ": ");
     }
 
     // Function name
     if (attr.has_function) {
         size_t n = 0;
-        s = extractFuncName(attr.function, &n); // Strip argument and return types
-        s.concat(s);
-        s.concat("(): ");
+        const char *name = extractFuncName(attr.function, &n); // Strip argument and return types
+        pos = appendf(s, pos, size, "%.*s(): ", (int)n, name);
     }
 
     // Level
-    s.concat(levelName(level));
-    s.concat(": ");
+    pos = appendf(s, pos, size, "%s: ", levelName(level));
 
     // Message
     if (msg) {
-        s.concat(msg);
+        pos = appendf(s, pos, size, "%s", msg);
     }
 
     // Additional attributes
     if (attr.has_code || attr.has_details) {
-        s.concat(" [");
+        pos = appendf(s, pos, size, " [");
         // Code
         if (attr.has_code) {
-            s.concat(String::format("code = %p" , (intptr_t)attr.code));
+            pos = appendf(s, pos, size, "code = %p", (void *)attr.code);
         }
         // Details
         if (attr.has_details) {
             if (attr.has_code) {
-                s.concat(", ");
+                pos = appendf(s, pos, size, ", ");
             }
-            s.concat("details = ");
-            s.concat(attr.details);
+            pos = appendf(s, pos, size, "details = %s", attr.details);
         }
-        s.concat(']');
+        pos = appendf(s, pos, size, "]");
     }
 
-    log(s);
-}
\ No newline at end of file
+    line.length = pos;
+    ATOMIC_BLOCK() {
+        line.state = LINE_READY;
+        m_pending++;
+    }
+}
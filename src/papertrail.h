@@ -6,18 +6,58 @@
 #error This library requires FW version 0.6.1 and above.
 #endif
 
+// PAPERTRAIL_LINE_SIZE : Longest log line, including the RFC 5424 header. Longer lines are truncated.
+#define PAPERTRAIL_LINE_SIZE 256
+
+// PAPERTRAIL_RING_LINES : Lines buffered between flushes. Lines logged while the ring is full are dropped.
+#define PAPERTRAIL_RING_LINES 8
+
+// PAPERTRAIL_DATAGRAM_SIZE : Largest UDP datagram; as many lines as fit are sent in each one.
+#define PAPERTRAIL_DATAGRAM_SIZE 1024
+
+// PAPERTRAIL_FLUSH_INTERVAL : Milliseconds between sends, unless the ring fills up first.
+#define PAPERTRAIL_FLUSH_INTERVAL 1000
+
 /// LogHandler that send logs to Papertrail (https://papertrailapp.com/). Before using this class it's best to
 /// familiarize yourself with Particle's loggin facility https://docs.particle.io/reference/firmware/photon/#logging.
 /// You can use this as any other LogHandler - Initialize this class as a global, then call Log.info() and friends.
+///
+/// Log calls only format the line into a fixed ring buffer, so they never touch the heap or the network.
+/// Call loop() from the application loop to send the buffered lines, several per datagram.
 class PapertrailLogHandler : public LogHandler {
-    String m_host;
+    struct Line {
+        volatile uint8_t state;
+        uint16_t length;
+        char text[PAPERTRAIL_LINE_SIZE];
+    };
+
+    enum {
+        LINE_FREE,
+        LINE_WRITING,
+        LINE_READY
+    };
+
+    char m_host[64];
     uint16_t m_port;
-    String m_app;
-    String m_system;
+    char m_header[96];
     UDP m_udp;
     bool m_inited;
     IPAddress m_address;
 
+    Line m_lines[PAPERTRAIL_RING_LINES];
+    uint8_t m_head;
+    uint8_t m_tail;
+    uint8_t m_pending;
+    uint32_t m_dropped;
+    uint32_t m_droppedTotal;
+    uint32_t m_lastFlush;
+
+    // ISO8601 timestamp, formatted once per second
+    char m_time[32];
+    time_t m_timeCached;
+
+    char m_packet[PAPERTRAIL_DATAGRAM_SIZE];
+
 public:
     /// Initialize the log handler.
     /// \param host Hostname of the Papertrail log server.
@@ -33,12 +73,23 @@ public:
                                   LogLevel level = LOG_LEVEL_INFO, const LogCategoryFilters &filters = {});
     virtual ~PapertrailLogHandler();
 
+    /// Send buffered lines once the flush interval has passed or the ring is filling up.
+    void loop();
+
+    /// Lines dropped because the ring was full, since boot.
+    uint32_t droppedLines() const { return m_droppedTotal + m_dropped; }
+
+    /// Lines waiting for the next flush.
+    uint8_t pendingLines() const { return m_pending; }
+
 private:
 
     bool lazyInit();
     const char* extractFileName(const char *s);
     const char* extractFuncName(const char *s, size_t *size);
-    void log(String message);
+    void flush();
+    bool send(size_t length);
+    const char* timestamp();
     static IPAddress resolve(const char *host);
     static const uint16_t kLocalPort;
 
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include "perf_counters.h"
+
+PerfCounter perfCounters[PERF_COUNTER_COUNT];
+
+static const char *const perfCounterNames[PERF_COUNTER_COUNT] = {
+  "render",       // PERF_RENDER
+  "show",         // PERF_SHOW
+  "mqttLoop",     // PERF_MQTT_LOOP
+  "mqttParse",    // PERF_MQTT_PARSE
+  "eepromWrite",  // PERF_EEPROM_WRITE
+};
+
+const char *perfCounterName(uint8_t id) {
+  return id < PERF_COUNTER_COUNT ? perfCounterNames[id] : NULL;
+}
+
+void perfBegin() {
+#ifdef PLATFORM_ID
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+void perfReset() {
+  for (uint8_t i = 0; i < PERF_COUNTER_COUNT; i++)
+    perfCounters[i].reset();
+}
+
+// 0 and 1 get their own buckets; above that each power of two is split in
+// half on the bit below the top one
+static uint8_t bucketOf(uint32_t cycles) {
+  if (cycles < 2)
+    return cycles;
+
+  uint8_t octave = 31 - __builtin_clz(cycles);
+  return octave * 2 + ((cycles >> (octave - 1)) & 1);
+}
+
+static uint32_t bucketTop(uint8_t bucket) {
+  if (bucket < 2)
+    return bucket;
+
+  uint8_t octave = bucket / 2;
+  uint32_t half = 1UL << (octave - 1);
+  uint32_t bottom = (1UL << octave) + (bucket & 1) * half;
+  return bottom + (half - 1);
+}
+
+void PerfCounter::reset() {
+  samples = 0;
+  minCycles = UINT32_MAX;
+  maxCycles = 0;
+  totalCycles = 0;
+  memset(buckets, 0, sizeof(buckets));
+}
+
+void PerfCounter::record(uint32_t cycles) {
+  samples++;
+  totalCycles += cycles;
+  if (cycles < minCycles)
+    minCycles = cycles;
+  if (cycles > maxCycles)
+    maxCycles = cycles;
+  buckets[bucketOf(cycles)]++;
+}
+
+uint32_t PerfCounter::percentile(uint8_t percent) const {
+  if (samples == 0)
+    return 0;
+
+  // Smallest bucket with at least percent% of the samples at or below it
+  uint32_t rank = ((uint64_t)samples * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < PERF_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= rank && seen > 0) {
+      uint32_t top = bucketTop(i);
+      return top < maxCycles ? top : maxCycles;
+    }
+  }
+  return maxCycles;
+}
+
+bool perfToJson(char *buf, size_t size) {
+  size_t pos = snprintf(buf, size, "{");
+
+  for (uint8_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+    if (pos >= size)
+      return false;
+
+    const PerfCounter &c = perfCounters[i];
+    pos += snprintf(buf + pos, size - pos, "%s\"%s\":{\"n\":%lu,\"min\":%lu,\"avg\":%lu,\"max\":%lu,\"p99\":%lu}",
+                    i ? "," : "", perfCounterNames[i], (unsigned long)c.count(), (unsigned long)c.min(),
+                    (unsigned long)c.average(), (unsigned long)c.max(), (unsigned long)c.percentile(99));
+  }
+
+  if (pos >= size)
+    return false;
+  pos += snprintf(buf + pos, size - pos, "}");
+  return pos < size;
+}
+
+void perfMetrics(LineProtocol &line, uint8_t id) {
+  const PerfCounter &c = perfCounters[id];
+  line.measurement("perf");
+  line.tag("device", "Skylight");
+  line.tag("counter", perfCounterNames[id]);
+  line.fieldUInt("n", c.count());
+  line.fieldUInt("min", c.min());
+  line.fieldUInt("avg", c.average());
+  line.fieldUInt("max", c.max());
+  line.fieldUInt("p99", c.percentile(99));
+}
+
+template<uint8_t ID> static void perfCounterMetrics(LineProtocol &line) {
+  perfMetrics(line, ID);
+}
+
+static const TelemetrySource perfSources[PERF_COUNTER_COUNT] = {
+  perfCounterMetrics<PERF_RENDER>,
+  perfCounterMetrics<PERF_SHOW>,
+  perfCounterMetrics<PERF_MQTT_LOOP>,
+  perfCounterMetrics<PERF_MQTT_PARSE>,
+  perfCounterMetrics<PERF_EEPROM_WRITE>,
+};
+
+bool perfAddMetrics(TelemetryRegistry &telemetry) {
+  for (uint8_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+    if (!telemetry.add(perfSources[i]))
+      return false;
+  }
+  return true;
+}
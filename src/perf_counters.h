@@ -0,0 +1,90 @@
+#ifndef __PERF_COUNTERS_H_
+#define __PERF_COUNTERS_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "telemetry.h"
+
+#ifdef PLATFORM_ID
+#include "Particle.h"
+#endif
+
+// Two buckets per power of two, covering the whole 32 bit cycle range
+#define PERF_BUCKETS 64
+
+/// Cycle count statistics for one code path. Samples are kept in a
+/// logarithmic histogram so percentiles cost no memory per sample; they are
+/// reported as the upper bound of their bucket, which is within 25% of the
+/// true value.
+class PerfCounter {
+public:
+  PerfCounter() { reset(); }
+
+  void record(uint32_t cycles);
+  void reset();
+
+  uint32_t count() const { return samples; }
+  uint32_t min() const { return samples ? minCycles : 0; }
+  uint32_t max() const { return maxCycles; }
+  uint32_t average() const { return samples ? totalCycles / samples : 0; }
+  uint32_t percentile(uint8_t percent) const;
+
+private:
+  uint32_t samples;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint32_t buckets[PERF_BUCKETS];
+};
+
+enum PerfCounterId {
+  PERF_RENDER,
+  PERF_SHOW,
+  PERF_MQTT_LOOP,
+  PERF_MQTT_PARSE,
+  PERF_EEPROM_WRITE,
+  PERF_COUNTER_COUNT
+};
+
+extern PerfCounter perfCounters[PERF_COUNTER_COUNT];
+
+const char *perfCounterName(uint8_t id);
+
+/// Start the DWT cycle counter. FastLED's bit-bang controller does the same
+/// on every show, so this is only needed for the DMA output.
+void perfBegin();
+
+#ifdef PLATFORM_ID
+inline uint32_t perfCycles() {
+  return DWT->CYCCNT;
+}
+#else
+// Host builds count cycles on their simulated clock
+uint32_t perfCycles();
+#endif
+
+/// Times the enclosing block into a counter.
+class PerfScope {
+public:
+  PerfScope(PerfCounterId id) : counter(perfCounters[id]), start(perfCycles()) {}
+  ~PerfScope() { counter.record(perfCycles() - start); }
+
+private:
+  PerfCounter &counter;
+  uint32_t start;
+};
+
+/// Every counter as {"render":{"n":..,"min":..,"avg":..,"max":..,"p99":..},..}
+/// in cycles. Returns false if it didn't fit.
+bool perfToJson(char *buf, size_t size);
+
+/// Write the "perf" line for one counter.
+void perfMetrics(LineProtocol &line, uint8_t id);
+
+/// Register a telemetry source per counter. Each line is collected on its
+/// own, so the counters never need more than one line's room in the buffer.
+bool perfAddMetrics(TelemetryRegistry &telemetry);
+
+void perfReset();
+
+#endif
@@ -0,0 +1,66 @@
+#include "photon_platform.h"
+#include "light.h"
+
+void PhotonPlatform::begin(CRGB *leds, uint16_t count) {
+#if LED_LANES > 1
+  // One controller clocks every lane out together, each from its own run of
+  // the buffer
+  FastLED.addLeds<WS2812_PORTB, LED_LANES, GRB>(leds, count / LED_LANES);
+#else
+  FastLED.addLeds<WS2812_DMA, LED_PIN, GRB>(leds, count);
+#endif
+  // Gamma and brightness are worked in 16 bits with the remainder carried
+  // over to the next frame; binary dithering is switched off below 100fps
+  FastLED.setDither(SIGMA_DELTA_DITHER);
+  FastLED.clear();
+  FastLED.show(0);
+}
+
+uint32_t PhotonPlatform::micros() {
+  return ::micros();
+}
+
+uint32_t PhotonPlatform::ticks() {
+  return System.ticks();
+}
+
+uint32_t PhotonPlatform::ticksPerMicrosecond() {
+  return System.ticksPerMicrosecond();
+}
+
+uint32_t PhotonPlatform::now() {
+  return Time.now();
+}
+
+void PhotonPlatform::setGamma(float gamma) {
+  FastLED.setGamma(gamma);
+}
+
+bool PhotonPlatform::ready() {
+  return FastLED.canShow();
+}
+
+bool PhotonPlatform::show(const CRGB *leds, uint16_t count, uint8_t brightness) {
+  return FastLED.tryShow(brightness);
+}
+
+bool PhotonPlatform::ditherPending() {
+  return FastLED.ditherPending();
+}
+
+uint32_t PhotonPlatform::framePower(const CRGB *leds, uint16_t count) {
+  return calculate_lit_power_mW(leds, count, FastLED[0].getGammaTable());
+}
+
+void PhotonPlatform::readSettings(int address, void *data, size_t length) {
+  HAL_EEPROM_Get(address, data, length);
+}
+
+void PhotonPlatform::writeSettings(int address, const void *data, size_t length) {
+  PerfScope scope(PERF_EEPROM_WRITE);
+  HAL_EEPROM_Put(address, data, length);
+}
+
+void PhotonPlatform::publish(const char *name, const char *data) {
+  Particle.publish(name, data, PRIVATE);
+}
@@ -0,0 +1,26 @@
+#ifndef __PHOTON_PLATFORM_H_
+#define __PHOTON_PLATFORM_H_
+
+#include "Particle.h"
+#include "light_platform.h"
+
+/// LightPlatform on the Photon: Device OS for the clocks, EEPROM and the
+/// cloud, and FastLED driving the strip.
+class PhotonPlatform : public LightPlatform {
+public:
+  void begin(CRGB *leds, uint16_t count);
+  uint32_t micros();
+  uint32_t ticks();
+  uint32_t ticksPerMicrosecond();
+  uint32_t now();
+  bool ready();
+  void setGamma(float gamma);
+  bool show(const CRGB *leds, uint16_t count, uint8_t brightness);
+  bool ditherPending();
+  uint32_t framePower(const CRGB *leds, uint16_t count);
+  void readSettings(int address, void *data, size_t length);
+  void writeSettings(int address, const void *data, size_t length);
+  void publish(const char *name, const char *data);
+};
+
+#endif
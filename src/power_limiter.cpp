@@ -0,0 +1,50 @@
+#include "power_limiter.h"
+
+// Share of the gap the ceiling closes each frame when recovering
+#define POWER_RELEASE_SHIFT 4
+
+PowerLimiter::PowerLimiter(uint32_t budget, uint32_t idle) : budget(budget), idle(idle) {
+}
+
+void PowerLimiter::setBudget(uint32_t mW) {
+  budget = mW;
+  if (budget == 0)
+    ceiling = target = 0xFF00;
+}
+
+uint8_t PowerLimiter::limit(uint8_t brightness) const {
+  uint8_t max = ceiling >> 8;
+  return brightness < max ? brightness : max;
+}
+
+uint8_t PowerLimiter::limitFrame(uint32_t fullPower, uint8_t requested) {
+  if (budget == 0)
+    return requested;
+
+  // Highest brightness this frame can go out at
+  uint32_t available = budget > idle ? budget - idle : 0;
+  uint32_t fits;
+  if (fullPower <= available)
+    fits = 255;
+  else
+    fits = (uint64_t)available * 256 / fullPower;
+  target = fits << 8;
+
+  if (target < ceiling)
+    ceiling = target;
+  else if (target > ceiling)
+    ceiling += ((target - ceiling) >> POWER_RELEASE_SHIFT) + 1;
+
+  bool wasThrottling = throttling;
+  throttling = limit(requested) < requested;
+  if (throttling && !wasThrottling)
+    throttleEvents++;
+  return limit(requested);
+}
+
+void PowerLimiter::recordFrame(uint32_t fullPower, uint8_t shown) {
+  power = idle + (uint64_t)fullPower * shown / 256;
+  avgPower = (avgPower * 7 + power) / 8;
+  if (power > maxPower)
+    maxPower = power;
+}
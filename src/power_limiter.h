@@ -0,0 +1,61 @@
+#ifndef __POWER_LIMITER_H_
+#define __POWER_LIMITER_H_
+
+#include <stdint.h>
+
+/// Keeps the strip within what the supply can deliver. Before every show it
+/// is told what the frame would draw at full brightness, and it works out the
+/// highest brightness that fits the budget. That ceiling drops straight away,
+/// so even the first frame of a flash of white goes out within budget, and
+/// recovers gradually, so the brightness doesn't pump as the content changes.
+class PowerLimiter {
+public:
+  /// budget is what the supply can deliver in mW (0 for no limit) and idle
+  /// what the rest of the board takes from it.
+  PowerLimiter(uint32_t budget = 0, uint32_t idle = 0);
+
+  void setBudget(uint32_t mW);
+  uint32_t getBudget() const { return budget; }
+
+  /// Brightness to show a frame at: the one asked for, capped by the ceiling.
+  uint8_t limit(uint8_t brightness) const;
+
+  /// Move the ceiling for a frame about to go out, from what it adds to the
+  /// idle draw at full brightness, and return the brightness to show it at:
+  /// requested, the one Light wants, capped by the new ceiling.
+  uint8_t limitFrame(uint32_t fullPower, uint8_t requested);
+
+  /// Account for a frame that has gone out at brightness shown.
+  void recordFrame(uint32_t fullPower, uint8_t shown);
+
+  /// Whether the ceiling is still climbing back while holding the brightness
+  /// down, so the same frame would go out brighter if shown again.
+  bool isRecovering() const { return throttling && ceiling < target; }
+
+  uint8_t getCeiling() const { return ceiling >> 8; }
+  bool isThrottling() const { return throttling; }
+
+  /// Estimated draw in mW, including the idle load.
+  uint32_t getPower() const { return power; }
+  uint32_t getAveragePower() const { return avgPower; }
+  uint32_t getMaxPower() const { return maxPower; }
+
+  /// Number of times the ceiling has started holding the brightness down.
+  uint32_t getThrottleEvents() const { return throttleEvents; }
+
+private:
+  uint32_t budget;
+  uint32_t idle;
+  // 8.8 fixed point so the ceiling can creep back up by fractions of a step
+  uint16_t ceiling = 0xFF00;
+  // Where the ceiling is heading: what the last frame fitted at
+  uint16_t target = 0xFF00;
+  bool throttling = false;
+
+  uint32_t power = 0;
+  uint32_t avgPower = 0;
+  uint32_t maxPower = 0;
+  uint32_t throttleEvents = 0;
+};
+
+#endif
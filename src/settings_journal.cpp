@@ -0,0 +1,70 @@
+#include <string.h>
+#include "settings_journal.h"
+#include "light_platform.h"
+
+SettingsJournal::SettingsJournal(int base, uint8_t slots, uint8_t payloadSize) :
+  base(base), slots(slots),
+  payloadSize(payloadSize <= SETTINGS_JOURNAL_MAX_PAYLOAD ? payloadSize : SETTINGS_JOURNAL_MAX_PAYLOAD),
+  slotSize(HEADER_SIZE + this->payloadSize + CRC_SIZE) {
+}
+
+// CRC-16/CCITT-FALSE
+uint16_t SettingsJournal::crc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  while (length--) {
+    crc ^= (uint16_t)*data++ << 8;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+bool SettingsJournal::load(LightPlatform &platform, void *data) {
+  uint8_t record[HEADER_SIZE + SETTINGS_JOURNAL_MAX_PAYLOAD + CRC_SIZE];
+  bool found = false;
+  uint16_t newest = 0;
+
+  for (uint8_t slot = 0; slot < slots; slot++) {
+    platform.readSettings(base + slot * slotSize, record, slotSize);
+
+    if (record[0] != MAGIC || record[1] != SETTINGS_JOURNAL_VERSION || record[4] != payloadSize)
+      continue;
+
+    uint16_t crc = (record[slotSize - 2] << 8) | record[slotSize - 1];
+    if (crc != crc16(record, slotSize - CRC_SIZE))
+      continue;
+
+    // Sequence numbers wrap, so compare them by difference
+    uint16_t sequence = (record[2] << 8) | record[3];
+    if (found && (int16_t)(sequence - newest) <= 0)
+      continue;
+
+    found = true;
+    newest = sequence;
+    nextSlot = (slot + 1) % slots;
+    memcpy(data, record + HEADER_SIZE, payloadSize);
+  }
+
+  if (found)
+    nextSequence = newest + 1;
+  return found;
+}
+
+void SettingsJournal::save(LightPlatform &platform, const void *data) {
+  uint8_t record[HEADER_SIZE + SETTINGS_JOURNAL_MAX_PAYLOAD + CRC_SIZE];
+
+  record[0] = MAGIC;
+  record[1] = SETTINGS_JOURNAL_VERSION;
+  record[2] = nextSequence >> 8;
+  record[3] = nextSequence & 0xFF;
+  record[4] = payloadSize;
+  memcpy(record + HEADER_SIZE, data, payloadSize);
+  uint16_t crc = crc16(record, slotSize - CRC_SIZE);
+  record[slotSize - 2] = crc >> 8;
+  record[slotSize - 1] = crc & 0xFF;
+
+  platform.writeSettings(base + nextSlot * slotSize, record, slotSize);
+
+  nextSlot = (nextSlot + 1) % slots;
+  nextSequence++;
+}
@@ -0,0 +1,48 @@
+#ifndef __SETTINGS_JOURNAL_H_
+#define __SETTINGS_JOURNAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+class LightPlatform;
+
+#define SETTINGS_JOURNAL_VERSION 1
+#define SETTINGS_JOURNAL_MAX_PAYLOAD 24
+
+/// Append-only store for a small settings blob. Every save writes a new
+/// record into the next of a ring of slots instead of overwriting one
+/// address, and each record carries a format version, a sequence number and
+/// a CRC. load() scans the ring and returns the newest record that checks
+/// out, so a write torn by a reset just falls back to the one before it.
+class SettingsJournal {
+public:
+  SettingsJournal(int base, uint8_t slots, uint8_t payloadSize);
+
+  /// Find the newest valid record. Returns false if there is none, leaving
+  /// data untouched.
+  bool load(LightPlatform &platform, void *data);
+
+  /// Append a record after the newest one.
+  void save(LightPlatform &platform, const void *data);
+
+  /// Bytes of settings storage the journal occupies.
+  int size() const { return slots * slotSize; }
+
+private:
+  enum {
+    HEADER_SIZE = 5, // magic, version, sequence (2), length
+    CRC_SIZE = 2,
+    MAGIC = 0xA5
+  };
+
+  static uint16_t crc16(const uint8_t *data, size_t length);
+
+  int base;
+  uint8_t slots;
+  uint8_t payloadSize;
+  uint8_t slotSize;
+  uint8_t nextSlot = 0;
+  uint16_t nextSequence = 0;
+};
+
+#endif
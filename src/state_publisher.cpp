@@ -0,0 +1,93 @@
+#include "state_publisher.h"
+
+StatePublisher::StatePublisher(Light &light, MQTT &client, const TopicRouter &topics) :
+  light(light), client(client), topics(topics) {
+}
+
+void StatePublisher::setRateLimit(uint8_t publishes, uint32_t interval) {
+  if (publishes == 0)
+    publishes = 1;
+
+  burst = publishes;
+  tokens = publishes;
+  refillInterval = interval / publishes;
+}
+
+void StatePublisher::loop(uint32_t now) {
+  if (light.isOn() != publishedPower)
+    dirty |= POWER;
+  if (light.getMode() != publishedMode)
+    dirty |= MODE;
+  if (light.getColor() != publishedColor)
+    dirty |= COLOR;
+  if (light.getBrightness() != publishedBrightness)
+    dirty |= BRIGHTNESS;
+
+  while (tokens < burst && now - lastRefill >= refillInterval) {
+    tokens++;
+    lastRefill += refillInterval;
+  }
+  if (tokens == burst)
+    lastRefill = now;
+
+  if (!dirty || !client.isConnected())
+    return;
+
+  for (uint8_t field = POWER; field & ALL && tokens > 0; field <<= 1) {
+    if (!(dirty & field))
+      continue;
+
+    // Leave the field dirty if the outbound queue is full
+    if (!publish(field))
+      break;
+
+    dirty &= ~field;
+    tokens--;
+  }
+}
+
+bool StatePublisher::publish(uint8_t field) {
+  char payload[12];
+
+  switch (field) {
+  case POWER:
+    if (!publish("switch", light.isOn() ? "ON" : "OFF"))
+      return false;
+    publishedPower = light.isOn();
+    return true;
+
+  case MODE: {
+    const char *name = effectName(light.getMode());
+    if (name && !publish("effect", name))
+      return false;
+    publishedMode = light.getMode();
+    return true;
+  }
+
+  case COLOR: {
+    uint32_t c = light.getColor();
+    snprintf(payload, sizeof(payload), "%u,%u,%u",
+      (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c);
+    if (!publish("rgb", payload))
+      return false;
+    publishedColor = c;
+    return true;
+  }
+
+  case BRIGHTNESS:
+    snprintf(payload, sizeof(payload), "%u", light.getBrightness());
+    if (!publish("brightness", payload))
+      return false;
+    publishedBrightness = light.getBrightness();
+    return true;
+  }
+  return true;
+}
+
+bool StatePublisher::publish(const char *suffix, const char *payload) {
+  char topic[TOPIC_ROUTER_MAX_PREFIX + 16];
+  if (!topics.topic(topic, sizeof(topic), suffix))
+    return true; // can never be sent, don't retry
+
+  return client.publish(topic, payload, true);
+}
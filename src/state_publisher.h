@@ -0,0 +1,53 @@
+#ifndef __STATE_PUBLISHER_H_
+#define __STATE_PUBLISHER_H_
+
+#include "mqtt.h"
+#include "light.h"
+#include "topic_router.h"
+
+/// Publishes the light's retained state topics. Commands only mark fields
+/// dirty, and loop() sends whatever is dirty in one batch, so a burst of
+/// commands (a Home Assistant scene, say) produces one publish per field
+/// rather than one per command. Fields are also marked dirty whenever the
+/// light's state differs from what was last published. A token bucket caps
+/// the publish rate; fields that don't fit the budget wait for a later tick.
+class StatePublisher {
+public:
+  enum {
+    POWER = 0x01,
+    MODE = 0x02,
+    COLOR = 0x04,
+    BRIGHTNESS = 0x08,
+    ALL = 0x0F
+  };
+
+  StatePublisher(Light &light, MQTT &client, const TopicRouter &topics);
+
+  /// Allow at most publishes messages per interval milliseconds.
+  void setRateLimit(uint8_t publishes, uint32_t interval);
+
+  void markDirty(uint8_t fields) { dirty |= fields; }
+  void loop(uint32_t now);
+
+private:
+  bool publish(uint8_t field);
+  bool publish(const char *suffix, const char *payload);
+
+  Light &light;
+  MQTT &client;
+  const TopicRouter &topics;
+  uint8_t dirty = ALL;
+
+  // Last values that made it out
+  bool publishedPower = false;
+  uint8_t publishedMode = Light::NONE;
+  uint32_t publishedColor = 0;
+  uint8_t publishedBrightness = 0;
+
+  uint8_t burst = 4;
+  uint8_t tokens = 4;
+  uint32_t refillInterval = 250;
+  uint32_t lastRefill = 0;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef __STRIP_LAYOUT_H_
+#define __STRIP_LAYOUT_H_
+
+#include <stdint.h>
+
+/// Geometry of a ring of LENGTH pixels with a mirror pixel that symmetric
+/// effects work outwards from. Everything is resolved at compile time, so
+/// wrapping round the ring is a mask for power of two lengths and a compare
+/// otherwise, and effects templated on a layout can drive a different size
+/// of skylight without runtime bounds checks.
+template<uint16_t STRIP_LENGTH, uint16_t STRIP_MIRROR = STRIP_LENGTH / 2>
+struct StripLayout {
+  enum {
+    LENGTH = STRIP_LENGTH,
+    LAST = STRIP_LENGTH - 1,
+    MIRROR = STRIP_MIRROR,
+    // Pixels on each side of the mirror
+    HALF = STRIP_LENGTH / 2,
+    POWER_OF_TWO = (STRIP_LENGTH & (STRIP_LENGTH - 1)) == 0
+  };
+
+  static_assert(STRIP_LENGTH > 1, "a strip needs at least two pixels");
+  static_assert(STRIP_MIRROR < STRIP_LENGTH, "mirror pixel is off the strip");
+
+  static inline uint16_t next(uint16_t p) {
+    return POWER_OF_TWO ? (p + 1) & LAST : (p == LAST ? 0 : p + 1);
+  }
+
+  static inline uint16_t prev(uint16_t p) {
+    return POWER_OF_TWO ? (p - 1) & LAST : (p == 0 ? LAST : p - 1);
+  }
+
+  static inline uint16_t step(uint16_t p, bool forwards) {
+    return forwards ? next(p) : prev(p);
+  }
+
+  /// A position up to one strip length past the last pixel, as a pixel.
+  static inline uint16_t wrap(uint16_t p) {
+    return POWER_OF_TWO ? p & LAST : (p >= LENGTH ? p - LENGTH : p);
+  }
+
+  /// The pixels distance+1 after and before the mirror, for distances up
+  /// to HALF.
+  static inline uint16_t afterMirror(uint16_t distance) {
+    return wrap(MIRROR + 1 + distance);
+  }
+
+  static inline uint16_t beforeMirror(uint16_t distance) {
+    return wrap(MIRROR + LENGTH - 1 - distance);
+  }
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include <string.h>
+#include "telemetry.h"
+
+LineProtocol::LineProtocol(char *buf, size_t size) : buf(buf), size(size) {
+  clear();
+}
+
+void LineProtocol::clear() {
+  pos = lineStart = 0;
+  lineCount = 0;
+  state = IDLE;
+  lineFailed = overflow = false;
+  if (size > 0)
+    buf[0] = '\0';
+}
+
+void LineProtocol::truncate(size_t length) {
+  if (length > lineStart)
+    return;
+  pos = lineStart = length;
+  lineCount = length > 0;
+  for (size_t i = 0; i < length; i++) {
+    if (buf[i] == '\n')
+      lineCount++;
+  }
+  state = IDLE;
+  lineFailed = overflow = false;
+  buf[pos] = '\0';
+}
+
+// One byte is always kept back for the terminator
+void LineProtocol::append(char c) {
+  if (pos + 1 >= size) {
+    lineFailed = true;
+    return;
+  }
+  buf[pos++] = c;
+}
+
+void LineProtocol::append(const char *s) {
+  while (*s && !lineFailed)
+    append(*s++);
+}
+
+void LineProtocol::appendEscaped(const char *s, const char *special) {
+  for (; *s && !lineFailed; s++) {
+    if (strchr(special, *s))
+      append('\\');
+    append(*s);
+  }
+}
+
+void LineProtocol::appendUnsigned(uint32_t value) {
+  char digits[10];
+  uint8_t n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+
+  while (n > 0)
+    append(digits[--n]);
+}
+
+void LineProtocol::measurement(const char *name) {
+  if (state != IDLE)
+    end();
+
+  if (lineStart > 0)
+    append('\n');
+  appendEscaped(name, ", ");
+  state = TAGS;
+}
+
+void LineProtocol::tag(const char *key, const char *value) {
+  if (state != TAGS)
+    return;
+
+  append(',');
+  appendEscaped(key, ",= ");
+  append('=');
+  appendEscaped(value, ",= ");
+}
+
+void LineProtocol::beginField(const char *key) {
+  append(state == FIELDS ? ',' : ' ');
+  appendEscaped(key, ",= ");
+  append('=');
+  state = FIELDS;
+}
+
+void LineProtocol::fieldInt(const char *key, int32_t value) {
+  if (state == IDLE)
+    return;
+
+  beginField(key);
+  if (value < 0) {
+    append('-');
+    appendUnsigned(-(uint32_t)value);
+  } else {
+    appendUnsigned(value);
+  }
+  append('i');
+}
+
+// Influx only accepts the "u" suffix when unsigned support is switched on,
+// so unsigned values go out as integers too
+void LineProtocol::fieldUInt(const char *key, uint32_t value) {
+  if (state == IDLE)
+    return;
+
+  beginField(key);
+  appendUnsigned(value);
+  append('i');
+}
+
+void LineProtocol::fieldFloat(const char *key, float value, uint8_t decimals) {
+  if (state == IDLE)
+    return;
+
+  beginField(key);
+  if (value < 0) {
+    append('-');
+    value = -value;
+  }
+
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; i++)
+    scale *= 10;
+
+  uint32_t fixed = value * scale + 0.5f;
+  appendUnsigned(fixed / scale);
+  if (decimals > 0) {
+    append('.');
+    uint32_t frac = fixed % scale;
+    for (uint32_t d = scale / 10; d > 0; d /= 10) {
+      append('0' + frac / d);
+      frac %= d;
+    }
+  }
+}
+
+void LineProtocol::fieldBool(const char *key, bool value) {
+  if (state == IDLE)
+    return;
+
+  beginField(key);
+  append(value ? "true" : "false");
+}
+
+void LineProtocol::fieldString(const char *key, const char *value) {
+  if (state == IDLE)
+    return;
+
+  beginField(key);
+  append('"');
+  appendEscaped(value, "\"\\");
+  append('"');
+}
+
+bool LineProtocol::end() {
+  if (state == IDLE)
+    return false;
+
+  bool ok = state == FIELDS && !lineFailed;
+  if (ok) {
+    lineStart = pos;
+    lineCount++;
+  } else {
+    if (lineFailed)
+      overflow = true;
+    pos = lineStart;
+  }
+
+  buf[pos] = '\0';
+  state = IDLE;
+  lineFailed = false;
+  return ok;
+}
+
+bool TelemetryRegistry::add(TelemetrySource source) {
+  if (count >= TELEMETRY_MAX_SOURCES)
+    return false;
+
+  sources[count++] = source;
+  return true;
+}
+
+uint8_t TelemetryRegistry::collect(LineProtocol &line, uint8_t first) const {
+  uint8_t i = first;
+  for (; i < count; i++) {
+    size_t mark = line.length();
+    sources[i](line);
+    line.end();
+
+    if (line.overflowed()) {
+      line.truncate(mark);
+      // Nothing else in the buffer, so it will never fit
+      if (mark == 0)
+        continue;
+      break;
+    }
+  }
+  return i;
+}
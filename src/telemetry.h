@@ -0,0 +1,82 @@
+#ifndef __TELEMETRY_H_
+#define __TELEMETRY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TELEMETRY_MAX_SOURCES 12
+
+/// Builds Influx line protocol ("measurement,tag=v field=1i,other=\"s\"")
+/// into a caller supplied buffer. Several measurements can be batched, one
+/// per line. A line that doesn't fit is dropped whole when it ends, so the
+/// buffer only ever holds complete lines; overflowed() reports that it
+/// happened.
+class LineProtocol {
+public:
+  LineProtocol(char *buf, size_t size);
+
+  void clear();
+
+  /// Start a new line, ending the previous one.
+  void measurement(const char *name);
+  void tag(const char *key, const char *value);
+
+  void fieldInt(const char *key, int32_t value);
+  void fieldUInt(const char *key, uint32_t value);
+  void fieldFloat(const char *key, float value, uint8_t decimals = 2);
+  void fieldBool(const char *key, bool value);
+  void fieldString(const char *key, const char *value);
+
+  /// Finish the current line. Returns false if it was dropped, either
+  /// because it overflowed or because it had no fields.
+  bool end();
+
+  /// Drop everything after length, e.g. a measurement that didn't fit.
+  void truncate(size_t length);
+
+  const char *c_str() const { return buf; }
+  size_t length() const { return lineStart; }
+  uint8_t lines() const { return lineCount; }
+  bool overflowed() const { return overflow; }
+
+private:
+  enum { IDLE, TAGS, FIELDS };
+
+  void beginField(const char *key);
+  void append(char c);
+  void append(const char *s);
+  void appendEscaped(const char *s, const char *special);
+  void appendUnsigned(uint32_t value);
+
+  char *buf;
+  size_t size;
+  size_t pos = 0;
+  size_t lineStart = 0;
+  uint8_t lineCount = 0;
+  uint8_t state = IDLE;
+  bool lineFailed = false;
+  bool overflow = false;
+};
+
+/// Writes one or more measurements for a subsystem.
+typedef void (*TelemetrySource)(LineProtocol &line);
+
+/// The set of subsystems that report metrics, collected together so they
+/// go out in as few messages as the buffer allows.
+class TelemetryRegistry {
+public:
+  bool add(TelemetrySource source);
+  uint8_t size() const { return count; }
+
+  /// Write sources from first onwards into line, stopping at the first one
+  /// that doesn't fit. Returns the index to resume from once the batch has
+  /// been sent. A source too big for an empty buffer is skipped so the
+  /// caller always makes progress.
+  uint8_t collect(LineProtocol &line, uint8_t first = 0) const;
+
+private:
+  TelemetrySource sources[TELEMETRY_MAX_SOURCES];
+  uint8_t count = 0;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <string.h>
+#include "topic_router.h"
+
+static bool isWildcard(const char *segment, uint8_t length) {
+  return length == 1 && (segment[0] == '+' || segment[0] == '#');
+}
+
+TopicRouter::TopicRouter(const char *prefix) {
+  setPrefix(prefix);
+}
+
+void TopicRouter::setPrefix(const char *prefix) {
+  strncpy(this->prefix, prefix, sizeof(this->prefix) - 1);
+  this->prefix[sizeof(this->prefix) - 1] = '\0';
+  prefixLength = strlen(this->prefix);
+}
+
+// Exact segments go to the front of the sibling list and wildcards to the
+// back, so matching tries exact levels before "+" and "#".
+int8_t TopicRouter::findOrAdd(int8_t *first, const char *segment, uint8_t length) {
+  int8_t *link = first;
+  for (int8_t i = *first; i >= 0; i = nodes[i].sibling) {
+    if (nodes[i].length == length && strncmp(nodes[i].segment, segment, length) == 0)
+      return i;
+    link = &nodes[i].sibling;
+  }
+
+  if (nodeCount >= TOPIC_ROUTER_MAX_NODES)
+    return -1;
+
+  int8_t n = nodeCount++;
+  nodes[n].segment = segment;
+  nodes[n].length = length;
+  nodes[n].child = -1;
+  nodes[n].handler = NULL;
+
+  if (isWildcard(segment, length)) {
+    nodes[n].sibling = -1;
+    *link = n;
+  } else {
+    nodes[n].sibling = *first;
+    *first = n;
+  }
+  return n;
+}
+
+bool TopicRouter::add(const char *pattern, TopicHandler handler) {
+  int8_t *level = &root;
+  int8_t node = -1;
+
+  while (true) {
+    const char *end = strchr(pattern, '/');
+    uint8_t length = end ? end - pattern : strlen(pattern);
+
+    // "#" has to be the whole of the last level
+    if (length == 1 && pattern[0] == '#' && end)
+      return false;
+
+    node = findOrAdd(level, pattern, length);
+    if (node < 0)
+      return false;
+
+    if (!end)
+      break;
+    level = &nodes[node].child;
+    pattern = end + 1;
+  }
+
+  nodes[node].handler = handler;
+  return true;
+}
+
+bool TopicRouter::add(const TopicRoute *routes, size_t count) {
+  bool ok = true;
+  for (size_t i = 0; i < count; i++)
+    ok = add(routes[i].pattern, routes[i].handler) && ok;
+  return ok;
+}
+
+TopicHandler TopicRouter::match(int8_t first, const char *topic) const {
+  const char *end = strchr(topic, '/');
+  uint8_t length = end ? end - topic : strlen(topic);
+  TopicHandler remainder = NULL;
+
+  for (int8_t i = first; i >= 0; i = nodes[i].sibling) {
+    const Node &n = nodes[i];
+
+    if (n.length == 1 && n.segment[0] == '#') {
+      remainder = n.handler;
+      continue;
+    }
+
+    if (!(n.length == 1 && n.segment[0] == '+') &&
+        !(n.length == length && strncmp(n.segment, topic, length) == 0))
+      continue;
+
+    if (!end) {
+      if (n.handler)
+        return n.handler;
+
+      // "a/#" also matches "a"
+      for (int8_t c = n.child; c >= 0; c = nodes[c].sibling) {
+        if (nodes[c].length == 1 && nodes[c].segment[0] == '#')
+          return nodes[c].handler;
+      }
+    } else {
+      TopicHandler handler = match(n.child, end + 1);
+      if (handler)
+        return handler;
+    }
+  }
+
+  return remainder;
+}
+
+bool TopicRouter::dispatch(const char *topic, char *payload, unsigned int length) const {
+  if (prefixLength > 0) {
+    if (strncmp(topic, prefix, prefixLength) != 0 || topic[prefixLength] != '/')
+      return false;
+    topic += prefixLength + 1;
+  }
+
+  TopicHandler handler = match(root, topic);
+  if (!handler)
+    return false;
+
+  handler(topic, payload, length);
+  return true;
+}
+
+bool TopicRouter::topic(char *buf, size_t size, const char *suffix) const {
+  int n;
+  if (prefixLength > 0)
+    n = snprintf(buf, size, "%s/%s", prefix, suffix);
+  else
+    n = snprintf(buf, size, "%s", suffix);
+  return n >= 0 && (size_t)n < size;
+}
@@ -0,0 +1,65 @@
+#ifndef __TOPIC_ROUTER_H_
+#define __TOPIC_ROUTER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TOPIC_ROUTER_MAX_NODES 24
+#define TOPIC_ROUTER_MAX_PREFIX 64
+
+/// Called with the topic relative to the device prefix and the payload as
+/// a writable, NUL terminated string.
+typedef void (*TopicHandler)(const char *topic, char *payload, unsigned int length);
+
+struct TopicRoute {
+  const char *pattern;
+  TopicHandler handler;
+};
+
+/// Routes inbound MQTT topics to handlers. Topics are expected to start with
+/// a device prefix (e.g. "home/light/playroom/skylight"), so the same
+/// firmware can serve several fixtures by changing only the prefix. Handlers
+/// are registered for the rest of the topic; patterns may use the MQTT "+"
+/// (one level) and "#" (all remaining levels) wildcards. Patterns are kept
+/// in a trie with one node per topic level, so dispatch costs one pass over
+/// the topic rather than a string compare per route.
+class TopicRouter {
+public:
+  TopicRouter(const char *prefix = "");
+
+  void setPrefix(const char *prefix);
+  const char *getPrefix() const { return prefix; }
+
+  /// Register a handler. The pattern is referenced, not copied, so it must
+  /// outlive the router; string literals in a route table are the intent.
+  /// Returns false if the pattern is malformed or the node pool is full.
+  bool add(const char *pattern, TopicHandler handler);
+  bool add(const TopicRoute *routes, size_t count);
+
+  /// Call the handler for a full topic. Returns false if nothing matched.
+  bool dispatch(const char *topic, char *payload, unsigned int length) const;
+
+  /// Write prefix + "/" + suffix into buf, for subscribing and publishing.
+  /// Returns false if it didn't fit.
+  bool topic(char *buf, size_t size, const char *suffix) const;
+
+private:
+  struct Node {
+    const char *segment;
+    uint8_t length;
+    int8_t child;
+    int8_t sibling;
+    TopicHandler handler;
+  };
+
+  int8_t findOrAdd(int8_t *first, const char *segment, uint8_t length);
+  TopicHandler match(int8_t first, const char *topic) const;
+
+  char prefix[TOPIC_ROUTER_MAX_PREFIX];
+  uint8_t prefixLength;
+  Node nodes[TOPIC_ROUTER_MAX_NODES];
+  uint8_t nodeCount = 0;
+  int8_t root = -1;
+};
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef __ALLOC_COUNT_H_
+#define __ALLOC_COUNT_H_
+
+#include <stdint.h>
+
+/// Heap allocations made through operator new since the program started.
+/// Linking alloc_count.cpp replaces the global operator new to count them.
+uint32_t allocationCount();
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __BENCH_H_
+#define __BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+
+/// Helpers for the host benchmarks. Each benchmark is its own executable that
+/// takes an iteration count as its first argument, so ctest can run it
+/// briefly to keep it building and working; run it by hand for real numbers.
+
+inline uint32_t benchIterations(int argc, char **argv, uint32_t fallback) {
+  return argc > 1 ? atoi(argv[1]) : fallback;
+}
+
+inline uint64_t benchNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Keep the optimiser from discarding work whose result is never read.
+inline void benchKeep(const void *p) {
+  asm volatile("" : : "g"(p) : "memory");
+}
+
+/// Average nanoseconds per call of fn over iterations calls.
+template<typename F> double benchNsPerCall(uint32_t iterations, F fn) {
+  uint64_t start = benchNanos();
+  for (uint32_t i = 0; i < iterations; i++)
+    fn();
+  return iterations ? (double)(benchNanos() - start) / iterations : 0;
+}
+
+#endif
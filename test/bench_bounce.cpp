@@ -0,0 +1,50 @@
+#include "bench.h"
+#include "light.h"
+#include "sim_platform.h"
+
+#define FRAMES 20000
+
+/// Render time of BounceEffect per frame as the number of balls grows. Each
+/// size is first run long enough for every ball to have been let on to the
+/// strip, with Light's clock driving the releases.
+template<uint8_t BALLS> static void report(uint32_t frames) {
+  SimPlatform sim;
+  Light light(sim);
+  light.setup();
+  BounceEffect<LightLayout, BALLS> effect;
+  effect.begin(light);
+
+  auto step = [&]() {
+    sim.advance(ANIMATION_STEP_US);
+    light.loop();
+  };
+
+  uint32_t warmUp = (uint32_t)BALLS * (BOUNCE_RELEASE_INTERVAL / ANIMATION_STEP_US) + 100;
+  for (uint32_t n = 0; n < warmUp; n++) {
+    step();
+    effect.renderFrame(light, ANIMATION_STEP_US);
+  }
+
+  uint64_t total = 0;
+  for (uint32_t n = 0; n < frames; n++) {
+    step();
+    uint64_t start = benchNanos();
+    effect.renderFrame(light, ANIMATION_STEP_US);
+    total += benchNanos() - start;
+    benchKeep(light.getLeds());
+  }
+  double ns = frames ? (double)total / frames : 0;
+  printf("%6u %10.0f %10.1f\n", BALLS, ns, ns / BALLS);
+}
+
+int main(int argc, char **argv) {
+  uint32_t frames = benchIterations(argc, argv, FRAMES);
+  printf("%6s %10s %10s\n", "balls", "ns/frame", "ns/ball");
+  report<5>(frames);
+  report<10>(frames);
+  report<20>(frames);
+  report<40>(frames);
+  report<80>(frames);
+  report<160>(frames);
+  return 0;
+}
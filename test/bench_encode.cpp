@@ -0,0 +1,80 @@
+#include <string.h>
+#include "bench.h"
+#include "FastLED.h"
+#include "clockless_encoder.h"
+
+FASTLED_USING_NAMESPACE
+
+#define NUM_LEDS 273
+#define FRAMES 20000
+
+typedef ClocklessTimerEncoder<NS(250), NS(625), NS(375), 2> Encoder;
+
+static CRGB leds[NUM_LEDS];
+static uint8_t frame[NUM_LEDS * 3];
+static uint8_t residue[NUM_LEDS * 3];
+static uint8_t wire[NUM_LEDS * 24];
+
+// The way the bit-banged loop used to work: each byte is loaded, dithered and
+// scaled as it is needed, and each bit's high time is decided as it goes out
+static uint8_t *encodePerByte(PixelController<GRB> &pixels, uint8_t *out) {
+  pixels.preStepFirstByteDithering();
+  uint8_t b = pixels.loadAndScale0();
+  while (pixels.has(1)) {
+    pixels.stepDithering();
+    out = Encoder::encodeByte(b, out);
+    b = pixels.loadAndScale1();
+    out = Encoder::encodeByte(b, out);
+    b = pixels.loadAndScale2();
+    out = Encoder::encodeByte(b, out);
+    b = pixels.advanceAndLoadAndScale0();
+  }
+  return out;
+}
+
+// Scale the whole frame first, then encode it in one pass
+static uint8_t *encodeFrame(PixelController<GRB> &pixels, uint8_t *out) {
+  uint8_t *end = pixels.loadAndScaleAll(frame);
+  return Encoder::encode(frame, end - frame, out);
+}
+
+static uint8_t *encodeSigmaDelta(PixelController<GRB> &pixels, uint8_t *out) {
+  bool pending;
+  uint8_t *end = pixels.loadAndScaleAll(frame, residue, pending);
+  return Encoder::encode(frame, end - frame, out);
+}
+
+template<typename F> static void report(const char *name, uint32_t frames, EDitherMode dither, F encode) {
+  CRGB scale(200, 200, 200);
+  double ns = benchNsPerCall(frames, [&]() {
+    PixelController<GRB> pixels(leds, NUM_LEDS, scale, dither);
+    benchKeep(encode(pixels, wire));
+  });
+  printf("%-14s %10.0f %10.1f\n", name, ns, NUM_LEDS * 3 * 1000.0 / ns);
+}
+
+/// Encode throughput of a frame of NUM_LEDS pixels, per byte as the old bit
+/// loop did it against scaling the frame up front and encoding it whole.
+int main(int argc, char **argv) {
+  uint32_t frames = benchIterations(argc, argv, FRAMES);
+  for (int i = 0; i < NUM_LEDS; i++)
+    leds[i] = CRGB(i * 7, i * 13, i * 29);
+
+  // Without dithering the two paths must put the same bits on the wire
+  CRGB scale(200, 200, 200);
+  uint8_t check[NUM_LEDS * 24];
+  PixelController<GRB> a(leds, NUM_LEDS, scale, DISABLE_DITHER);
+  PixelController<GRB> b(leds, NUM_LEDS, scale, DISABLE_DITHER);
+  uint8_t *end = encodePerByte(a, check);
+  if (end - check != (int)sizeof(wire) || encodeFrame(b, wire) != wire + sizeof(wire) ||
+      memcmp(check, wire, sizeof(wire)) != 0) {
+    printf("per byte and whole frame encodings differ\n");
+    return 1;
+  }
+
+  printf("%-14s %10s %10s\n", "path", "ns/frame", "MB/s");
+  report("per byte", frames, BINARY_DITHER, encodePerByte);
+  report("whole frame", frames, BINARY_DITHER, encodeFrame);
+  report("sigma-delta", frames, SIGMA_DELTA_DITHER, encodeSigmaDelta);
+  return 0;
+}
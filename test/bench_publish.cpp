@@ -0,0 +1,90 @@
+#include "bench.h"
+#include "mqtt.h"
+#include "sim_platform.h"
+
+#define PUBLISHES 200000
+
+static void onMessage(char *topic, uint8_t *payload, unsigned int length) {}
+
+static const char *STATE_TOPIC = "home/skylight/rgb/state";
+static const char *STATE = "255,128,0";
+static const char *METRICS_TOPIC = "telegraf/particle";
+static const char *METRICS = "light,device=Skylight mode=2i,on=true,brightness=180i,renderAvg=412i,"
+  "renderMax=980i,showAvg=8420i,showMax=8610i,showInterval=20000i,cpuBudget=60i";
+
+// How publish() used to assemble a packet: clear the whole packet buffer,
+// copy topic and payload into it a byte at a time, then write it in one go
+static uint8_t staging[MQTT_MAX_PACKET_SIZE];
+static void publishStaged(TCPClient &socket, const char *topic, const char *payload) {
+  memset(staging, 0, sizeof(staging));
+  uint16_t length = 5;
+  uint16_t topicLength = strlen(topic);
+  staging[length++] = topicLength >> 8;
+  staging[length++] = topicLength & 0xFF;
+  for (const char *c = topic; *c; c++)
+    staging[length++] = *c;
+  for (const char *c = payload; *c && length < sizeof(staging); c++)
+    staging[length++] = *c;
+  staging[3] = MQTTPUBLISH;
+  staging[4] = length - 5;
+  socket.write(staging + 3, length - 3, 0);
+}
+
+static void report(const char *path, const char *name, double ns, double copied) {
+  printf("%-10s %-10s %12.0f %12.1f\n", path, name, 1e9 / ns, copied);
+}
+
+/// Publishes per second and bytes copied per publish (into the outbound ring,
+/// or the staging buffer publish() used to fill) for a state update and a
+/// telemetry line, against a loopback socket that either takes everything or
+/// only a little per loop().
+int main(int argc, char **argv) {
+  uint32_t publishes = benchIterations(argc, argv, PUBLISHES);
+  SimPlatform sim;
+  MQTT client((char*)"broker", 1883, onMessage, 512);
+  TCPClient &socket = *TCPClient::loopback();
+  client.connect("skylight");
+  const uint8_t connack[] = {MQTTCONNACK, 2, 0, MQTT::CONN_ACCEPT};
+  socket.receive(connack, sizeof(connack));
+  client.loop();
+  if (!client.isConnected()) {
+    printf("loopback connect failed\n");
+    return 1;
+  }
+
+  printf("%-10s %-10s %12s %12s\n", "path", "message", "publish/s", "copied/pub");
+  const char *topics[] = {STATE_TOPIC, METRICS_TOPIC};
+  const char *payloads[] = {STATE, METRICS};
+  const char *names[] = {"state", "telemetry"};
+  for (int m = 0; m < 2; m++) {
+    socket.setWindow((size_t)-1);
+    double ns = benchNsPerCall(publishes, [&]() {
+      publishStaged(socket, topics[m], payloads[m]);
+      socket.sent.clear();
+    });
+    // Everything after the fixed header goes through the staging buffer
+    report("staged", names[m], ns, 2 + strlen(topics[m]) + strlen(payloads[m]));
+
+    // A socket with room for everything
+    uint32_t copied = client.getBytesCopied();
+    ns = benchNsPerCall(publishes, [&]() {
+      client.publish(topics[m], payloads[m]);
+      socket.sent.clear();
+    });
+    report("direct", names[m], ns, (double)(client.getBytesCopied() - copied) / publishes);
+
+    // A socket that takes 64 bytes between loop() calls, so the rest waits
+    // in the ring
+    copied = client.getBytesCopied();
+    ns = benchNsPerCall(publishes, [&]() {
+      socket.setWindow(64);
+      client.publish(topics[m], payloads[m]);
+      socket.setWindow((size_t)-1);
+      client.loop();
+      socket.sent.clear();
+    });
+    report("partial", names[m], ns, (double)(client.getBytesCopied() - copied) / publishes);
+  }
+
+  return client.isConnected() ? 0 : 1;
+}
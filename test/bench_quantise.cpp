@@ -0,0 +1,97 @@
+#include <math.h>
+#include <string.h>
+#include "bench.h"
+#include "FastLED.h"
+
+FASTLED_USING_NAMESPACE
+
+#define NUM_LEDS 273
+#define FRAMES 20000
+#define GAMMA 2.2f
+
+static CRGB leds[NUM_LEDS];
+static uint16_t gamma16[256];
+static uint8_t frame[NUM_LEDS * 3];
+static uint8_t residue[NUM_LEDS * 3];
+
+// The same table CLEDController::setGamma builds
+static void buildGamma() {
+  for (int i = 0; i < 256; i++)
+    gamma16[i] = (uint16_t)(pow(i / 255.0f, GAMMA) * 0xFF00 + 0.5f);
+}
+
+static uint8_t *quantise8(PixelController<GRB> &pixels) {
+  return pixels.loadAndScaleAll(frame);
+}
+
+static uint8_t *quantiseSigmaDelta(PixelController<GRB> &pixels) {
+  bool pending;
+  return pixels.loadAndScaleAll(frame, residue, pending);
+}
+
+// Over DITHER_CYCLE frames of a static frame every residue comes back round,
+// so each byte sent must add up to its exact 8.8 value
+#define DITHER_CYCLE 256
+static bool averagesOut(uint8_t brightness) {
+  CRGB scale(brightness, brightness, brightness);
+  static uint32_t totals[NUM_LEDS * 3];
+  memset(totals, 0, sizeof(totals));
+  for (int f = 0; f < DITHER_CYCLE; f++) {
+    PixelController<GRB> pixels(leds, NUM_LEDS, scale, SIGMA_DELTA_DITHER, gamma16);
+    quantiseSigmaDelta(pixels);
+    for (int i = 0; i < NUM_LEDS * 3; i++)
+      totals[i] += frame[i];
+  }
+
+  uint16_t k = brightness + (brightness != 0);
+  for (int i = 0; i < NUM_LEDS; i++) {
+    const uint8_t wire[3] = { leds[i].g, leds[i].r, leds[i].b };
+    for (int c = 0; c < 3; c++) {
+      uint32_t exact = ((uint32_t)gamma16[wire[c]] * k) >> 8;
+      if (totals[i * 3 + c] != exact)
+        return false;
+    }
+  }
+  return true;
+}
+
+template<typename F> static void report(const char *name, uint32_t frames, uint8_t brightness, EDitherMode dither, F quantise) {
+  CRGB scale(brightness, brightness, brightness);
+  double ns = benchNsPerCall(frames, [&]() {
+    PixelController<GRB> pixels(leds, NUM_LEDS, scale, dither, gamma16);
+    benchKeep(quantise(pixels));
+  });
+  printf("%-14s %10u %10.0f %10.2f\n", name, brightness, ns, ns / (NUM_LEDS * 3));
+}
+
+/// Per frame cost of gamma correcting and scaling NUM_LEDS pixels for the
+/// wire, rounding to 8 bits against carrying the remainder over with the
+/// sigma-delta quantiser, at a dim and a bright global brightness. Also the
+/// pass Light makes over the frame for its power draw before each show.
+int main(int argc, char **argv) {
+  uint32_t frames = benchIterations(argc, argv, FRAMES);
+  buildGamma();
+  for (int i = 0; i < NUM_LEDS; i++)
+    leds[i] = CRGB(i * 7, i * 13, i * 29);
+  for (int i = 0; i < NUM_LEDS * 3; i++)
+    residue[i] = i * 157;
+
+  if (!averagesOut(5) || !averagesOut(200)) {
+    printf("sigma-delta output doesn't average out to the exact value\n");
+    return 1;
+  }
+
+  printf("%-14s %10s %10s %10s\n", "quantiser", "brightness", "ns/frame", "ns/byte");
+  report("8 bit", frames, 5, DISABLE_DITHER, quantise8);
+  report("8 bit", frames, 200, DISABLE_DITHER, quantise8);
+  report("sigma-delta", frames, 5, SIGMA_DELTA_DITHER, quantiseSigmaDelta);
+  report("sigma-delta", frames, 200, SIGMA_DELTA_DITHER, quantiseSigmaDelta);
+
+  double ns = benchNsPerCall(frames, [&]() {
+    static uint32_t mW;
+    mW = calculate_lit_power_mW(leds, NUM_LEDS, gamma16);
+    benchKeep(&mW);
+  });
+  printf("%-14s %10s %10.0f %10.2f\n", "power", "-", ns, ns / (NUM_LEDS * 3));
+  return 0;
+}
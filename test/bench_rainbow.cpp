@@ -0,0 +1,42 @@
+#include "bench.h"
+#include "light.h"
+#include "sim_platform.h"
+
+#define FRAMES 20000
+
+// Four animation steps, which move the rainbow on by one hue
+#define FRAME_US (4 * ANIMATION_STEP_US)
+
+/// Time per frame of RainbowEffect against fill_rainbow() on Light's strip,
+/// after checking the effect draws exactly what fill_rainbow() would for
+/// every starting hue.
+int main(int argc, char **argv) {
+  uint32_t frames = benchIterations(argc, argv, FRAMES);
+  SimPlatform sim;
+  Light light(sim);
+  CRGB *leds = light.getLeds();
+  CRGB expected[LightLayout::LENGTH];
+
+  RainbowEffect<LightLayout> effect;
+  effect.begin(light);
+  for (int n = 1; n <= 256; n++) {
+    effect.renderFrame(light, FRAME_US);
+    fill_rainbow(expected, LightLayout::LENGTH, (uint8_t)-n, 2);
+    if (memcmp(expected, leds, sizeof(expected)) != 0) {
+      printf("rainbow differs from fill_rainbow at hue %d\n", (uint8_t)-n);
+      return 1;
+    }
+  }
+
+  printf("%-14s %10s\n", "path", "ns/frame");
+  uint8_t hue = 0;
+  printf("%-14s %10.0f\n", "fill_rainbow", benchNsPerCall(frames, [&]() {
+    fill_rainbow(leds, LightLayout::LENGTH, hue--, 2);
+    benchKeep(leds);
+  }));
+  printf("%-14s %10.0f\n", "RainbowEffect", benchNsPerCall(frames, [&]() {
+    effect.renderFrame(light, FRAME_US);
+    benchKeep(leds);
+  }));
+  return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef __HOST_APPLICATION_H_
+#define __HOST_APPLICATION_H_
+
+// Just enough of the Device OS application API for the networking code to
+// build on the host. The clock is the simulated platform's.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint32_t system_tick_t;
+
+uint32_t micros();
+uint32_t millis();
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef __HOST_SPARK_WIRING_STRING_H_
+#define __HOST_SPARK_WIRING_STRING_H_
+
+#include <string>
+
+/// The parts of Wiring's String the networking code uses.
+class String {
+public:
+  String(const char *s = "") : value(s ? s : "") {}
+  String &operator=(const char *s) { value = s ? s : ""; return *this; }
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+
+private:
+  std::string value;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef __HOST_SPARK_WIRING_TCPCLIENT_H_
+#define __HOST_SPARK_WIRING_TCPCLIENT_H_
+
+#include <vector>
+#include "application.h"
+
+/// Loopback stand-in for Device OS's TCPClient. Everything written is kept
+/// in sent(), and what a test passes to receive() is read back as if the
+/// broker had sent it. Writes that may not wait (timeout 0) only take what
+/// is left of the send window; writes that may wait always complete, as if
+/// the broker had caught up in the meantime.
+class TCPClient {
+public:
+  TCPClient() { loopback() = this; }
+  ~TCPClient() { if (loopback() == this) loopback() = NULL; }
+
+  /// The most recently created client, for tests to drive.
+  static TCPClient *&loopback() {
+    static TCPClient *client = NULL;
+    return client;
+  }
+
+  int connect(const char *host, uint16_t port) { open = accepting; return open; }
+  int connect(const uint8_t *ip, uint16_t port) { open = accepting; return open; }
+  uint8_t connected() { return open; }
+  void stop() { open = false; }
+
+  int available() { return open ? incoming.size() - readPos : 0; }
+  int read() {
+    if (!open || readPos == incoming.size())
+      return -1;
+    return incoming[readPos++];
+  }
+
+  size_t write(const uint8_t *buf, size_t size, system_tick_t timeout = 0) {
+    if (!open)
+      return -1;
+    if (timeout == 0 && size > window)
+      size = window;
+    if (timeout == 0)
+      window -= size;
+    sent.insert(sent.end(), buf, buf + size);
+    writes++;
+    return size;
+  }
+
+  // Test side
+  void refuse(bool refusing) { accepting = !refusing; }
+  void receive(const uint8_t *data, size_t length) { incoming.insert(incoming.end(), data, data + length); }
+  void setWindow(size_t bytes) { window = bytes; }
+  void drop() { open = false; }
+
+  std::vector<uint8_t> sent;
+  uint32_t writes = 0;
+
+private:
+  bool accepting = true;
+  bool open = false;
+  size_t window = (size_t)-1;
+  std::vector<uint8_t> incoming;
+  size_t readPos = 0;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef __HOST_SPARK_WIRING_USBSERIAL_H_
+#define __HOST_SPARK_WIRING_USBSERIAL_H_
+
+// Serial is only used for debug output, which the host build leaves off
+
+#endif
@@ -0,0 +1,44 @@
+#include <stdlib.h>
+#include "light.h"
+#include "sim_platform.h"
+#include "alloc_count.h"
+
+// Simulated time each mode is measured over, after it has faded in
+#define REPORT_SECONDS 20
+
+/// Runs every mode through Light::loop() on the simulated clock and reports
+/// what a frame costs on this host: render time in nanoseconds from Light's
+/// own per-effect counters, and heap allocations per rendered frame. Pass a
+/// number of seconds to measure over a different stretch.
+int main(int argc, char **argv) {
+  uint32_t seconds = argc > 1 ? atoi(argv[1]) : REPORT_SECONDS;
+  bool allocating = false;
+
+  printf("%-12s %8s %8s %10s %10s %12s\n", "mode", "frames", "shown", "avg ns", "max ns", "allocs/frame");
+  for (uint8_t mode = Light::STATIC; mode <= Light::BOUNCE; mode++) {
+    SimPlatform sim(SimPlatform::HOST_TICKS);
+    Light light(sim);
+    light.setup();
+    light.setColor(255, 128, 0);
+    light.setMode((Light::MODES)mode);
+    light.on();
+    sim.run(light, 3000000);
+
+    light.resetEffectStats();
+    uint32_t shown = sim.framesShown();
+    uint32_t allocations = allocationCount();
+    sim.run(light, seconds * 1000000);
+    allocations = allocationCount() - allocations;
+
+    const Light::EffectStats &stats = light.getEffectStats((Light::MODES)mode);
+    uint32_t avg = stats.frames ? stats.totalNs / stats.frames : 0;
+    printf("%-12s %8u %8u %10u %10u %12.2f\n", effectName(mode), stats.frames,
+           sim.framesShown() - shown, avg, stats.maxNs,
+           stats.frames ? (double)allocations / stats.frames : 0.0);
+    if (allocations)
+      allocating = true;
+  }
+
+  // Nothing on the render path should touch the heap once running
+  return allocating ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+#include <chrono>
+#include "sim_platform.h"
+#include "light.h"
+
+// Wall clock the simulation starts at
+#define SIM_EPOCH 1600000000
+// Simulated time already gone by when Light starts, as it would be on the
+// Photon after booting and connecting
+#define SIM_BOOT_TIME 5000000
+
+/// Stands in for the strip's controller: scales, gamma corrects and dithers
+/// each frame the way the Photon's controllers do, then keeps the bytes.
+class CaptureController : public CLEDController {
+public:
+  uint8_t *frame = NULL;
+  int frameSize = 0;
+  int frameBytes = 0;
+
+  void init() {}
+
+  void clearLeds(int nLeds) {
+    showColor(CRGB(0, 0, 0), nLeds, 0);
+  }
+
+protected:
+  void showColor(const struct CRGB &data, int nLeds, CRGB scale) {
+    PixelController<GRB> pixels(data, nLeds, scale, getDither(), getGammaTable());
+    capture(pixels);
+  }
+
+  void show(const struct CRGB *data, int nLeds, CRGB scale) {
+    PixelController<GRB> pixels(data, nLeds, scale, getDither(), getGammaTable());
+    capture(pixels);
+  }
+
+private:
+  void capture(PixelController<GRB> &pixels) {
+    int size = pixels.mLen * 3;
+    if (size > frameSize) {
+      delete [] frame;
+      frame = new uint8_t[size];
+      frameSize = size;
+    }
+    frameBytes = loadAndScaleFrame(pixels, frame) - frame;
+  }
+};
+
+static CaptureController capture;
+static SimPlatform *active = NULL;
+
+SimPlatform::SimPlatform(TickSource tickSource) : tickSource(tickSource), clock(SIM_BOOT_TIME) {
+  memset(storage, 0xFF, sizeof(storage));
+  lastData[0] = '\0';
+  active = this;
+}
+
+SimPlatform::~SimPlatform() {
+  if (active == this)
+    active = NULL;
+}
+
+void SimPlatform::begin(CRGB *leds, uint16_t count) {
+  FastLED.addLeds(&capture, leds, count);
+  // FastLED caps the refresh rate by spinning on micros(), which never
+  // returns if the virtual clock hasn't moved since the last show, as when a
+  // new simulation starts. Light's scheduler paces the shows anyway.
+  FastLED.setMaxRefreshRate(0);
+  FastLED.setDither(SIGMA_DELTA_DITHER);
+  FastLED.clear();
+  FastLED.show(0);
+  shown = 0;
+}
+
+uint32_t SimPlatform::micros() {
+  return clock;
+}
+
+uint32_t SimPlatform::ticks() {
+  if (tickSource == HOST_TICKS) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+  return clock * 120;
+}
+
+uint32_t SimPlatform::ticksPerMicrosecond() {
+  return tickSource == HOST_TICKS ? 1000 : 120;
+}
+
+uint32_t SimPlatform::now() {
+  return SIM_EPOCH + clock / 1000000;
+}
+
+bool SimPlatform::ready() {
+  return !outputBusy && FastLED.canShow();
+}
+
+void SimPlatform::setGamma(float gamma) {
+  FastLED.setGamma(gamma);
+}
+
+bool SimPlatform::show(const CRGB *leds, uint16_t count, uint8_t brightness) {
+  if (outputBusy || !FastLED.tryShow(brightness))
+    return false;
+
+  shown++;
+  wire = capture.frame;
+  wireBytes = capture.frameBytes;
+  this->brightness = brightness;
+  return true;
+}
+
+bool SimPlatform::ditherPending() {
+  return FastLED.ditherPending();
+}
+
+uint32_t SimPlatform::framePower(const CRGB *leds, uint16_t count) {
+  return calculate_lit_power_mW(leds, count, capture.getGammaTable());
+}
+
+void SimPlatform::readSettings(int address, void *data, size_t length) {
+  memcpy(data, storage + address, length);
+}
+
+void SimPlatform::writeSettings(int address, const void *data, size_t length) {
+  memcpy(storage + address, data, length);
+  writes++;
+}
+
+void SimPlatform::publish(const char *name, const char *data) {
+  published++;
+  snprintf(lastData, sizeof(lastData), "%s", data);
+}
+
+void SimPlatform::advance(uint32_t us) {
+  clock += us;
+}
+
+void SimPlatform::run(Light &light, uint32_t duration, uint32_t interval) {
+  for (uint32_t t = 0; t < duration; t += interval) {
+    light.loop();
+    advance(interval);
+  }
+}
+
+// The runtime FastLED and the performance counters expect, on the active
+// simulation's clock
+
+uint32_t micros() {
+  return active ? active->micros() : 0;
+}
+
+uint32_t millis() {
+  return micros() / 1000;
+}
+
+void delay(unsigned long ms) {
+  if (active)
+    active->advance(ms * 1000);
+}
+
+uint32_t perfCycles() {
+  return active ? active->ticks() : 0;
+}
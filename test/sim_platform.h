@@ -0,0 +1,83 @@
+#ifndef __SIM_PLATFORM_H_
+#define __SIM_PLATFORM_H_
+
+#include "light_platform.h"
+
+// Same size as the Photon's emulated EEPROM
+#define SIM_SETTINGS_SIZE 2047
+#define SIM_PUBLISH_SIZE 64
+
+class Light;
+
+/// LightPlatform for the host build. Time only moves when the test says so,
+/// so a run is repeatable however fast the host is. Output goes through
+/// FastLED exactly as on the Photon, gamma and dithering included, into a
+/// controller that keeps the last frame it was sent rather than clocking it
+/// out of a pin. Settings live in a RAM copy of the EEPROM.
+///
+/// Only one SimPlatform is in use at a time: the one constructed last also
+/// provides micros(), millis() and delay() to FastLED, and perfCycles() to
+/// the performance counters.
+class SimPlatform : public LightPlatform {
+public:
+  /// Where ticks() comes from. VIRTUAL_TICKS follows the simulated clock at
+  /// the Photon's 120 ticks a microsecond, so Light's render timings only
+  /// move when the test advances time. HOST_TICKS reads the host's
+  /// monotonic clock in nanoseconds, for measuring what the code costs.
+  enum TickSource { VIRTUAL_TICKS, HOST_TICKS };
+
+  SimPlatform(TickSource tickSource = VIRTUAL_TICKS);
+  ~SimPlatform();
+
+  void begin(CRGB *leds, uint16_t count);
+  uint32_t micros();
+  uint32_t ticks();
+  uint32_t ticksPerMicrosecond();
+  uint32_t now();
+  bool ready();
+  void setGamma(float gamma);
+  bool show(const CRGB *leds, uint16_t count, uint8_t brightness);
+  bool ditherPending();
+  uint32_t framePower(const CRGB *leds, uint16_t count);
+  void readSettings(int address, void *data, size_t length);
+  void writeSettings(int address, const void *data, size_t length);
+  void publish(const char *name, const char *data);
+
+  /// Move the simulated clock on.
+  void advance(uint32_t us);
+
+  /// Call light.loop() every interval microseconds of simulated time for
+  /// duration microseconds.
+  void run(Light &light, uint32_t duration, uint32_t interval = 1000);
+
+  /// Frames that reached the strip, and the last one as it went out on the
+  /// wire: three bytes per pixel in GRB order, after gamma, brightness and
+  /// dithering.
+  uint32_t framesShown() const { return shown; }
+  const uint8_t *wireFrame() const { return wire; }
+  uint16_t wireLength() const { return wireBytes; }
+  uint8_t shownBrightness() const { return brightness; }
+
+  /// Simulate the strip still clocking out the previous frame.
+  void setBusy(bool busy) { outputBusy = busy; }
+
+  uint8_t *settings() { return storage; }
+  uint32_t settingsWrites() const { return writes; }
+  uint32_t publishes() const { return published; }
+  const char *lastPublish() const { return lastData; }
+
+private:
+  TickSource tickSource;
+  uint64_t clock;
+  uint32_t shown = 0;
+  const uint8_t *wire = NULL;
+  uint16_t wireBytes = 0;
+  uint8_t brightness = 0;
+  bool outputBusy = false;
+  uint8_t storage[SIM_SETTINGS_SIZE];
+  uint32_t writes = 0;
+  uint32_t published = 0;
+  char lastData[SIM_PUBLISH_SIZE];
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef __TEST_H_
+#define __TEST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+/// Minimal test runner for the host build. Tests register themselves with
+/// TEST(name), checks report the file and line they failed on and carry on,
+/// and main() returns non-zero if anything failed so ctest sees it.
+
+typedef void (*TestFunction)();
+
+struct TestCase {
+  const char *name;
+  TestFunction function;
+  TestCase *next;
+};
+
+inline TestCase *&testList() {
+  static TestCase *head = NULL;
+  return head;
+}
+
+inline int &testFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+struct TestRegistrar {
+  TestCase entry;
+  TestRegistrar(const char *name, TestFunction function) {
+    entry.name = name;
+    entry.function = function;
+    // Keep the order they appear in the file
+    TestCase **tail = &testList();
+    while (*tail)
+      tail = &(*tail)->next;
+    entry.next = NULL;
+    *tail = &entry;
+  }
+};
+
+#define TEST(name) \
+  static void name(); \
+  static TestRegistrar name##Registrar(#name, name); \
+  static void name()
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      testFailures()++; \
+    } \
+  } while (0)
+
+#define CHECK_EQUAL(expected, actual) do { \
+    long long e_ = (long long)(expected), a_ = (long long)(actual); \
+    if (e_ != a_) { \
+      printf("  %s:%d: expected %s == %lld, got %lld\n", __FILE__, __LINE__, #actual, e_, a_); \
+      testFailures()++; \
+    } \
+  } while (0)
+
+inline int runTests() {
+  int failedTests = 0;
+  for (TestCase *t = testList(); t; t = t->next) {
+    int before = testFailures();
+    t->function();
+    bool ok = testFailures() == before;
+    printf("%s %s\n", ok ? "PASS" : "FAIL", t->name);
+    if (!ok)
+      failedTests++;
+  }
+  return failedTests ? 1 : 0;
+}
+
+#define TEST_MAIN() int main() { return runTests(); }
+
+#endif
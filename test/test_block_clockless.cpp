@@ -0,0 +1,181 @@
+#include "test.h"
+#include "FastLED.h"
+#include "sim_platform.h"
+
+#include <vector>
+
+FASTLED_USING_NAMESPACE
+
+// Stand-ins for the Photon's registers, so the block controller builds and runs on the host.  Every read of the
+// cycle counter is one cycle, and picks up whatever the controller last wrote to BSRR.
+
+#define ADJ 8
+#define BLOCK_LANES 3
+#define LANE_LENGTH 4
+
+static const uint32_t BSRR_IDLE = 0xFFFFFFFF;
+static volatile uint32_t gpiob[2] = { 0, BSRR_IDLE };
+
+struct Edge {
+  uint32_t cycle;
+  uint32_t odr;
+};
+
+static uint32_t cycles;
+static std::vector<Edge> edges;
+
+struct CycleCounter {
+  operator uint32_t() {
+    cycles++;
+    uint32_t bsrr = gpiob[1];
+    if (bsrr != BSRR_IDLE) {
+      gpiob[0] = (gpiob[0] | (bsrr & 0xFFFF)) & ~(bsrr >> 16);
+      gpiob[1] = BSRR_IDLE;
+      Edge edge = { cycles, gpiob[0] };
+      edges.push_back(edge);
+    }
+    return cycles;
+  }
+};
+
+struct FakeDWT { CycleCounter CYCCNT; uint32_t CTRL; };
+struct FakeCoreDebug { uint32_t DEMCR; };
+static FakeDWT fakeDWT;
+static FakeCoreDebug fakeCoreDebug;
+
+#define DWT (&fakeDWT)
+#define CoreDebug (&fakeCoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk 1
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define _CYCCNT ((uint32_t)fakeDWT.CYCCNT)
+
+FASTLED_NAMESPACE_BEGIN
+#define _BLOCKPIN(PIN, BIT) template<> class FastPin<PIN> { \
+public: \
+  static void setOutput() {} \
+  static volatile uint32_t *port() { return gpiob; } \
+  static uint32_t mask() { return 1 << BIT; } \
+};
+// D0-D4 are GPIOB bits 7-3
+_BLOCKPIN(0, 7); _BLOCKPIN(1, 6); _BLOCKPIN(2, 5); _BLOCKPIN(3, 4); _BLOCKPIN(4, 3);
+FASTLED_NAMESPACE_END
+
+#include "clockless_block_arm_stm32.h"
+
+// The WS2812_PORTB chipset, as FastLED.addLeds builds it on the Photon
+typedef InlineBlockClocklessController<BLOCK_LANES, PORTB_FIRST_PIN, NS(250), NS(625), NS(375), GRB> WS2812Block;
+
+struct Bit {
+  bool one;
+  uint32_t high;
+  uint32_t period;
+};
+
+// Rebuild one lane's bits from the edges on its port bit
+static std::vector<Bit> laneBits(int lane) {
+  uint32_t mask = FastPin<PORTB_FIRST_PIN>::mask() >> lane;
+  std::vector<uint32_t> rises, falls;
+  bool level = false;
+  for (size_t i = 0; i < edges.size(); i++) {
+    bool now = (edges[i].odr & mask) != 0;
+    if (now != level)
+      (now ? rises : falls).push_back(edges[i].cycle);
+    level = now;
+  }
+
+  std::vector<Bit> bits;
+  for (size_t i = 0; i < rises.size() && i < falls.size(); i++) {
+    Bit bit;
+    // The edge is seen on the read after the write that made it
+    bit.high = falls[i] - rises[i] - 1;
+    bit.period = i + 1 < rises.size() ? rises[i + 1] - rises[i] : 0;
+    bit.one = bit.high + ADJ / 2 > NS(250) + NS(625) / 2;
+    bits.push_back(bit);
+  }
+  return bits;
+}
+
+static uint32_t cyclesToNs(uint32_t c) {
+  return c * 1000 / (F_CPU / 1000000);
+}
+
+// Supplies micros() for the latch wait between frames
+static SimPlatform sim;
+
+static void showFrame(const CRGB *leds) {
+  static WS2812Block block;
+  CLEDController &controller = block;
+  controller.init();
+  controller.setDither(DISABLE_DITHER);
+  sim.advance(1000);
+  edges.clear();
+  controller.show(leds, LANE_LENGTH, (uint8_t)255);
+}
+
+TEST(everyLaneSendsItsOwnBlockOfTheBuffer) {
+  CRGB leds[BLOCK_LANES * LANE_LENGTH];
+  for (int i = 0; i < BLOCK_LANES * LANE_LENGTH; i++)
+    leds[i] = CRGB(i * 21 + 1, 0xA5 ^ i, 255 - i * 13);
+  showFrame(leds);
+
+  for (int lane = 0; lane < BLOCK_LANES; lane++) {
+    std::vector<Bit> bits = laneBits(lane);
+    CHECK_EQUAL(LANE_LENGTH * 24, (int)bits.size());
+    for (int p = 0; p < LANE_LENGTH; p++) {
+      const CRGB &led = leds[lane * LANE_LENGTH + p];
+      const uint8_t wire[3] = { led.g, led.r, led.b };
+      for (int slot = 0; slot < 3; slot++) {
+        uint8_t expected = scale8(wire[slot], 255);
+        uint8_t sent = 0;
+        for (int i = 0; i < 8; i++)
+          sent = (sent << 1) | bits[(p * 3 + slot) * 8 + i].one;
+        CHECK_EQUAL(expected, sent);
+      }
+    }
+  }
+}
+
+TEST(bitTimingsStayWithinTheWS2812Datasheet) {
+  CRGB leds[BLOCK_LANES * LANE_LENGTH];
+  for (int i = 0; i < BLOCK_LANES * LANE_LENGTH; i++)
+    leds[i] = CRGB(0xF0, 0x0F, 0x55);
+  showFrame(leds);
+
+  std::vector<Bit> bits = laneBits(0);
+  CHECK(bits.size() > 0);
+  for (size_t i = 0; i < bits.size(); i++) {
+    // The bit loop's own cycles, which ADJ takes back out of the timings, put the rest back on the wire
+    uint32_t high = cyclesToNs(bits[i].high + ADJ / 2);
+    // T0H 400ns and T1H 800ns, each +/-150ns
+    if (bits[i].one) {
+      CHECK(high >= 650);
+      CHECK(high <= 950);
+    } else {
+      CHECK(high >= 250);
+      CHECK(high <= 550);
+    }
+    // 1250ns +/-600ns
+    if (bits[i].period) {
+      uint32_t period = cyclesToNs(bits[i].period + ADJ);
+      CHECK(period >= 650);
+      CHECK(period <= 1850);
+    }
+  }
+}
+
+TEST(lanesShareEveryRisingEdge) {
+  CRGB leds[BLOCK_LANES * LANE_LENGTH];
+  for (int i = 0; i < BLOCK_LANES * LANE_LENGTH; i++)
+    leds[i] = CRGB(i, 255 - i, i * 7);
+  showFrame(leds);
+
+  std::vector<Bit> first = laneBits(0);
+  for (int lane = 1; lane < BLOCK_LANES; lane++) {
+    std::vector<Bit> bits = laneBits(lane);
+    CHECK_EQUAL(first.size(), bits.size());
+    for (size_t i = 0; i + 1 < bits.size() && i + 1 < first.size(); i++)
+      CHECK_EQUAL(first[i].period, bits[i].period);
+  }
+}
+
+TEST_MAIN()
@@ -0,0 +1,66 @@
+#include "test.h"
+#include "FastLED.h"
+#include "clockless_encoder.h"
+
+FASTLED_USING_NAMESPACE
+
+// WS2812 at 800kHz, as the DMA controller drives it from a 60MHz timer
+#define CLOCKS_PER_TICK (F_CPU / 60000000)
+typedef ClocklessTimerEncoder<NS(250), NS(625), NS(375), CLOCKS_PER_TICK> WS2812Encoder;
+
+static uint32_t ticksToNs(uint32_t ticks) {
+  return ticks * CLOCKS_PER_TICK * 1000 / (F_CPU / 1000000);
+}
+
+TEST(timingsStayWithinTheWS2812Datasheet) {
+  // T0H 400ns, T1H 800ns and a 1250ns bit, each +/-150ns
+  CHECK(ticksToNs(WS2812Encoder::ZERO_HIGH) >= 250);
+  CHECK(ticksToNs(WS2812Encoder::ZERO_HIGH) <= 550);
+  CHECK(ticksToNs(WS2812Encoder::ONE_HIGH) >= 650);
+  CHECK(ticksToNs(WS2812Encoder::ONE_HIGH) <= 950);
+  CHECK(ticksToNs(WS2812Encoder::PERIOD) >= 1100);
+  CHECK(ticksToNs(WS2812Encoder::PERIOD) <= 1400);
+}
+
+TEST(timingsRoundToTheNearestTick) {
+  typedef ClocklessTimerEncoder<30, 75, 45, 2> Encoder;
+  CHECK_EQUAL(75, Encoder::PERIOD);
+  CHECK_EQUAL(15, Encoder::ZERO_HIGH);
+  CHECK_EQUAL(53, Encoder::ONE_HIGH);
+}
+
+TEST(bytesAreEncodedMsbFirst) {
+  uint16_t out[8];
+  uint16_t *end = WS2812Encoder::encodeByte(0xA1, out);
+  CHECK_EQUAL(8, end - out);
+  const int bits[8] = { 1, 0, 1, 0, 0, 0, 0, 1 };
+  for (int i = 0; i < 8; i++)
+    CHECK_EQUAL(bits[i] ? WS2812Encoder::ONE_HIGH : WS2812Encoder::ZERO_HIGH, out[i]);
+}
+
+TEST(everyByteDecodesBackToItself) {
+  uint8_t data[256];
+  for (int i = 0; i < 256; i++)
+    data[i] = i;
+
+  uint8_t out[256 * 8];
+  uint8_t *end = WS2812Encoder::encode(data, 256, out);
+  CHECK_EQUAL(256 * 8, end - out);
+
+  for (int i = 0; i < 256; i++) {
+    uint8_t b = 0;
+    for (int bit = 0; bit < 8; bit++) {
+      int decoded = WS2812Encoder::decodeBit(out[i * 8 + bit]);
+      CHECK(decoded == 0 || decoded == 1);
+      b = (b << 1) | decoded;
+    }
+    CHECK_EQUAL(i, b);
+  }
+}
+
+TEST(latchIsNotABit) {
+  CHECK_EQUAL(-1, WS2812Encoder::decodeBit(WS2812Encoder::LATCH));
+  CHECK(WS2812Encoder::LATCH < WS2812Encoder::ZERO_HIGH);
+}
+
+TEST_MAIN()
@@ -0,0 +1,120 @@
+// First, so a header that leans on something light.h defines fails to build
+#include "effects.h"
+#include "test.h"
+#include "light.h"
+#include "sim_platform.h"
+
+#include <string.h>
+
+TEST(arenaIsSizedForTheLayout) {
+  typedef StripLayout<30, 15> SmallLayout;
+  CHECK(effectArenaSize<SmallLayout>() >= sizeof(BounceEffect<SmallLayout>));
+  CHECK(effectArenaSize<SmallLayout>() < effectArenaSize<LightLayout>());
+  CHECK_EQUAL(effectArenaSize<LightLayout>(), sizeof(EffectArena));
+}
+
+TEST(everyModeHasANamedEffect) {
+  EffectArena arena;
+  CHECK(createEffect(Light::NONE, arena) == NULL);
+  for (uint8_t mode = Light::STATIC; mode <= Light::BOUNCE; mode++) {
+    Effect *effect = createEffect(mode, arena);
+    CHECK(effect != NULL);
+    CHECK((void*)effect == (void*)arena.data);
+    effect->~Effect();
+    CHECK_EQUAL(mode, effectMode(effectName(mode)));
+  }
+  CHECK_EQUAL(Light::NONE, effectMode("disco"));
+}
+
+class CountingEffect : public Effect {
+public:
+  int advanced = 0;
+protected:
+  bool advance(Light &light) { advanced++; return true; }
+};
+
+TEST(aStallIsCaughtUpInFull) {
+  SimPlatform sim;
+  Light light(sim);
+  CountingEffect effect;
+  effect.renderFrame(light, 3 * ANIMATION_STEP_US + 1);
+  CHECK_EQUAL(3, effect.advanced);
+  // The microsecond left over carries into the next render
+  effect.renderFrame(light, ANIMATION_MAX_CATCH_UP - 1);
+  CHECK_EQUAL(3 + ANIMATION_MAX_CATCH_UP / ANIMATION_STEP_US, effect.advanced);
+}
+
+TEST(aLongerStallIsCaughtUpToTheClocksBound) {
+  SimPlatform sim;
+  Light light(sim);
+  AnimationClock clock;
+  clock.start(0);
+  CountingEffect effect;
+  effect.renderFrame(light, clock.advance(5 * ANIMATION_MAX_CATCH_UP));
+  CHECK_EQUAL(ANIMATION_MAX_CATCH_UP / ANIMATION_STEP_US, effect.advanced);
+}
+
+// Bounce's frame buffer after 999 steps, rendered a few steps at a time
+// with Light's animation clock moving on between renders as it does live
+static void runBounce(uint16_t stepsPerRender, CRGB *out) {
+  SimPlatform sim;
+  Light light(sim);
+  light.setup();
+  random16_set_seed(1234);
+  BounceEffect<LightLayout> bounce;
+  bounce.begin(light);
+  for (int step = 0; step < 999; step += stepsPerRender) {
+    sim.advance(stepsPerRender * ANIMATION_STEP_US);
+    light.loop();
+    bounce.renderFrame(light, stepsPerRender * ANIMATION_STEP_US);
+  }
+  memcpy(out, light.getLeds(), sizeof(CRGB) * LightLayout::LENGTH);
+}
+
+TEST(bounceReleasesBallsOnTheStepNotTheFrame) {
+  // Renders of several steps at a time run the same steps, releases
+  // included, as one step a render. Three steps a render doesn't divide the
+  // release interval, so a release timed by the render would move.
+  static CRGB stepped[LightLayout::LENGTH], caughtUp[LightLayout::LENGTH];
+  runBounce(1, stepped);
+  runBounce(3, caughtUp);
+  CHECK(memcmp(stepped, caughtUp, sizeof(stepped)) == 0);
+}
+
+// Christmas from scratch: the pixel distance i from the mirror takes the
+// band that (step + i) falls in, and the mirror pixel itself is left alone
+static void paintChristmas(CRGB *leds, uint16_t step) {
+  for (uint16_t i = 0; i < LightLayout::HALF; i++) {
+    const CRGB &color = christmasPalette[(step + i) / CHRISTMAS_BAND_WIDTH % 3];
+    leds[LightLayout::afterMirror(i)] = color;
+    leds[LightLayout::beforeMirror(i)] = color;
+  }
+}
+
+// Each step only repaints the first pixel of every band; after every tick
+// the strip must match the whole pattern painted for that step. The
+// skylight's mirror is near the end, so the bands wrap round pixel 0, and
+// the run goes past two cycles of the palette so the band index and the
+// step both wrap.
+TEST(christmasStepsMatchTheFullPattern) {
+  SimPlatform sim;
+  Light light(sim);
+  CRGB *leds = light.getLeds();
+  const CRGB unset(1, 2, 3);
+  for (int i = 0; i < LightLayout::LENGTH; i++)
+    leds[i] = unset;
+
+  ChristmasEffect<LightLayout> christmas;
+  static CRGB expected[LightLayout::LENGTH];
+  const uint16_t cycle = CHRISTMAS_BAND_WIDTH * 3;
+  for (uint16_t tick = 0; tick < (2 * cycle + 5) * CHRISTMAS_STEP_TICKS; tick++) {
+    CHECK_EQUAL(tick % CHRISTMAS_STEP_TICKS == 0, christmas.advance(light));
+    for (int i = 0; i < LightLayout::LENGTH; i++)
+      expected[i] = unset;
+    paintChristmas(expected, tick / CHRISTMAS_STEP_TICKS % cycle);
+    CHECK(memcmp(expected, leds, sizeof(expected)) == 0);
+  }
+  CHECK(leds[LightLayout::MIRROR] == unset);
+}
+
+TEST_MAIN()
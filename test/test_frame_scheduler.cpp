@@ -0,0 +1,43 @@
+#include "test.h"
+#include "frame_scheduler.h"
+
+TEST(lateStepsLandInTheirBucket) {
+  FrameScheduler scheduler(10000, 20000, 100000);
+  CHECK(scheduler.stepDue(10000));
+  // One interval lost, then three, then forty
+  CHECK(scheduler.stepDue(30000));
+  CHECK(scheduler.stepDue(70000));
+  CHECK(scheduler.stepDue(480000));
+  CHECK_EQUAL(1, scheduler.getMisses(0));
+  CHECK_EQUAL(1, scheduler.getMisses(1));
+  CHECK_EQUAL(1, scheduler.getMisses(5));
+}
+
+TEST(resetStartsAnInterval) {
+  FrameScheduler scheduler;
+  scheduler.stepDue(10000);
+  scheduler.stepDue(50000);
+  scheduler.recordRender(900);
+  scheduler.recordShow(8000);
+  scheduler.resetStats();
+  CHECK_EQUAL(0, scheduler.getMaxRender());
+  CHECK_EQUAL(0, scheduler.getMaxShow());
+  for (uint8_t i = 0; i < FRAME_MISS_BUCKETS; i++)
+    CHECK_EQUAL(0, scheduler.getMisses(i));
+  // Averages steer the show interval and carry over
+  CHECK(scheduler.getAverageShow() > 0);
+}
+
+TEST(smallerBudgetStretchesTheShowInterval) {
+  FrameScheduler scheduler(10000, 20000, 100000);
+  for (int i = 0; i < 32; i++) {
+    scheduler.recordRender(2000);
+    scheduler.recordShow(8000);
+  }
+  uint32_t interval = scheduler.getShowInterval();
+  scheduler.setCpuBudget(30);
+  CHECK(scheduler.getShowInterval() > interval);
+  CHECK_EQUAL(30, scheduler.getCpuBudget());
+}
+
+TEST_MAIN()
@@ -0,0 +1,98 @@
+#include <string.h>
+#include "test.h"
+#include "FastLED.h"
+#include "lib8tion_x4.h"
+
+FASTLED_USING_NAMESPACE
+
+// The packed kernels must agree with lib8tion's single byte functions bit
+// for bit, for every byte value in every lane and every scale
+
+static uint32_t pack(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  return a | (b << 8) | (c << 16) | ((uint32_t)d << 24);
+}
+
+static uint8_t lane(uint32_t w, int i) {
+  return w >> (i * 8);
+}
+
+TEST(scale8x4MatchesScale8) {
+  for (int scale = 0; scale < 256; scale++) {
+    for (int v = 0; v < 256; v++) {
+      // The byte under test in each lane, with its neighbours at the
+      // extremes so a carry or borrow between lanes would show
+      uint32_t w = pack(v, 255 - v, v ^ 0x80, 255);
+      uint32_t x = scale8x4(w, scale);
+      for (int i = 0; i < 4; i++) {
+        if (lane(x, i) != scale8(lane(w, i), scale)) {
+          CHECK_EQUAL(scale8(lane(w, i), scale), lane(x, i));
+          return;
+        }
+      }
+    }
+  }
+}
+
+TEST(scale8x4VideoMatchesScale8Video) {
+  for (int scale = 0; scale < 256; scale++) {
+    for (int v = 0; v < 256; v++) {
+      uint32_t w = pack(v, 0, 255 - v, v & 1);
+      uint32_t x = scale8x4_video(w, scale);
+      for (int i = 0; i < 4; i++) {
+        if (lane(x, i) != scale8_video(lane(w, i), scale)) {
+          CHECK_EQUAL(scale8_video(lane(w, i), scale), lane(x, i));
+          return;
+        }
+      }
+    }
+  }
+}
+
+// Every alignment and a length that leaves a ragged head and tail
+TEST(bufferKernelsMatchAtAnyAlignment) {
+  uint8_t source[64];
+  for (int i = 0; i < (int)sizeof(source); i++)
+    source[i] = i * 37 + 11;
+
+  const uint8_t scales[] = {0, 1, 64, 127, 128, 200, 255};
+  for (uint8_t scale : scales) {
+    for (int offset = 0; offset < 4; offset++) {
+      for (int count = 0; count <= 40; count++) {
+        alignas(4) uint8_t plain[64], video[64];
+        memcpy(plain, source, sizeof(plain));
+        memcpy(video, source, sizeof(video));
+        nscale8_bytes(plain + offset, count, scale);
+        nscale8_video_bytes(video + offset, count, scale);
+
+        for (int i = 0; i < (int)sizeof(source); i++) {
+          bool inside = i >= offset && i < offset + count;
+          uint8_t wantPlain = inside ? scale8(source[i], scale) : source[i];
+          uint8_t wantVideo = inside ? scale8_video(source[i], scale) : source[i];
+          if (plain[i] != wantPlain || video[i] != wantVideo) {
+            CHECK_EQUAL(wantPlain, plain[i]);
+            CHECK_EQUAL(wantVideo, video[i]);
+            return;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(ledScalingMatchesPerPixelScaling) {
+  CRGB leds[17], expected[17];
+  for (int i = 0; i < 17; i++)
+    leds[i] = expected[i] = CRGB(i * 15, 255 - i * 9, i & 1 ? 1 : 0);
+
+  nscale8(leds, 17, 100);
+  for (int i = 0; i < 17; i++)
+    expected[i].nscale8(100);
+  CHECK(memcmp(leds, expected, sizeof(leds)) == 0);
+
+  nscale8_video(leds, 17, 3);
+  for (int i = 0; i < 17; i++)
+    expected[i].nscale8_video(3);
+  CHECK(memcmp(leds, expected, sizeof(leds)) == 0);
+}
+
+TEST_MAIN()
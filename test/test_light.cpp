@@ -0,0 +1,144 @@
+#include "test.h"
+#include "light.h"
+#include "sim_platform.h"
+
+// Bring the light up in a mode and let it fade in
+static void start(SimPlatform &sim, Light &light, Light::MODES mode) {
+  light.setup();
+  light.setMode(mode);
+  light.on();
+  sim.run(light, 3000000);
+}
+
+TEST(staticColourReachesTheStrip) {
+  SimPlatform sim;
+  Light light(sim);
+  light.setColor(255, 0, 0);
+  start(sim, light, Light::STATIC);
+
+  CHECK_EQUAL(Light::STATIC, light.getMode());
+  CHECK_EQUAL(LightLayout::LENGTH * 3, sim.wireLength());
+  // GRB on the wire, red at full brightness
+  CHECK_EQUAL(0, sim.wireFrame()[0]);
+  CHECK_EQUAL(255, sim.wireFrame()[1]);
+  CHECK_EQUAL(0, sim.wireFrame()[2]);
+}
+
+TEST(offFadesToBlackAndStopsShowing) {
+  SimPlatform sim;
+  Light light(sim);
+  start(sim, light, Light::RAINBOW);
+  CHECK(sim.framesShown() > 0);
+
+  light.off();
+  sim.run(light, 3000000);
+  uint32_t shown = sim.framesShown();
+  for (int i = 0; i < LightLayout::LENGTH * 3; i++) {
+    if (sim.wireFrame()[i] != 0) {
+      CHECK_EQUAL(0, sim.wireFrame()[i]);
+      break;
+    }
+  }
+
+  sim.run(light, 1000000);
+  CHECK_EQUAL(shown, sim.framesShown());
+}
+
+TEST(staticFrameStopsOnceTheDitheringHasCycled) {
+  SimPlatform sim;
+  Light light(sim);
+  // Fractions after gamma on every channel, so the dithering has work to do
+  light.setColor(100, 50, 20);
+  start(sim, light, Light::STATIC);
+
+  sim.run(light, 10000000);
+  uint32_t shown = sim.framesShown();
+  sim.run(light, 2000000);
+  CHECK_EQUAL(shown, sim.framesShown());
+
+  // A new colour starts the dithering over
+  light.setColor(101, 50, 20);
+  sim.run(light, 100000);
+  CHECK(sim.framesShown() > shown + 1);
+}
+
+TEST(showWaitsForABusyStrip) {
+  SimPlatform sim;
+  Light light(sim);
+  start(sim, light, Light::RAINBOW);
+
+  sim.setBusy(true);
+  uint32_t shown = sim.framesShown();
+  sim.run(light, 500000);
+  CHECK_EQUAL(shown, sim.framesShown());
+
+  sim.setBusy(false);
+  sim.run(light, 100000);
+  CHECK(sim.framesShown() > shown);
+}
+
+// Draw of the frame last sent, from the bytes on the wire
+static uint32_t wirePower(SimPlatform &sim) {
+  uint32_t sums[3] = { 0, 0, 0 };
+  for (int i = 0; i < sim.wireLength(); i += 3) {
+    sums[0] += sim.wireFrame()[i + 1];
+    sums[1] += sim.wireFrame()[i];
+    sums[2] += sim.wireFrame()[i + 2];
+  }
+  return calculate_power_from_sums_mW(sums, sim.wireLength() / 3) + POWER_IDLE_MW;
+}
+
+TEST(jumpToWhiteNeverGoesOutOverBudget) {
+  SimPlatform sim;
+  Light light(sim);
+  light.setColor(0, 0, 0);
+  start(sim, light, Light::STATIC);
+
+  // Dithering can round any byte of a frame up a step, which the next frame
+  // takes back
+  const uint32_t dither[3] = { LightLayout::LENGTH, LightLayout::LENGTH, LightLayout::LENGTH };
+  const uint32_t budget = POWER_BUDGET_MW + calculate_power_from_sums_mW(dither, 0);
+
+  light.setColor(255, 255, 255);
+  uint32_t shown = sim.framesShown();
+  for (int ms = 0; ms < 1000; ms++) {
+    sim.run(light, 1000);
+    if (sim.framesShown() != shown) {
+      shown = sim.framesShown();
+      CHECK(wirePower(sim) <= budget);
+    }
+  }
+  CHECK(light.getPowerLimiter().isThrottling());
+}
+
+TEST(settingsSurviveARestart) {
+  SimPlatform sim;
+  {
+    Light light(sim);
+    light.loadSettings();
+    light.setup();
+    light.setColor(1, 2, 3);
+    light.setBrightness(42);
+    light.setMode(Light::METEORS);
+    light.saveSettings();
+    sim.run(light, SETTINGS_SAVE_DELAY + 1000000);
+  }
+
+  Light light(sim);
+  light.loadSettings();
+  CHECK_EQUAL(Light::METEORS, light.getMode());
+  CHECK_EQUAL(42, light.getBrightness());
+  CHECK_EQUAL(0x010203, light.getColor());
+}
+
+TEST(everyModeRendersFrames) {
+  for (uint8_t mode = Light::STATIC; mode <= Light::BOUNCE; mode++) {
+    SimPlatform sim;
+    Light light(sim);
+    light.setColor(0, 0, 255);
+    start(sim, light, (Light::MODES)mode);
+    CHECK(light.getEffectStats((Light::MODES)mode).frames > 0);
+  }
+}
+
+TEST_MAIN()
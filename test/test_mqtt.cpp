@@ -0,0 +1,222 @@
+#include "test.h"
+#include "mqtt.h"
+#include "perf_counters.h"
+#include "sim_platform.h"
+
+#include <string>
+
+static void onMessage(char *topic, uint8_t *payload, unsigned int length) {}
+
+static std::string lastTopic, lastPayload;
+static int messages;
+static void recordMessage(char *topic, uint8_t *payload, unsigned int length) {
+  lastTopic = topic;
+  lastPayload.assign((const char *)payload, length);
+  messages++;
+}
+
+// Open a session and let the broker accept it
+static TCPClient &connect(MQTT &client) {
+  TCPClient &socket = *TCPClient::loopback();
+  client.connect("skylight");
+  const uint8_t connack[] = {MQTTCONNACK, 2, 0, MQTT::CONN_ACCEPT};
+  socket.receive(connack, sizeof(connack));
+  client.loop();
+  socket.sent.clear();
+  return socket;
+}
+
+TEST(publishGoesStraightToAnIdleSocket) {
+  SimPlatform sim;
+  MQTT client((char*)"broker", 1883, onMessage);
+  TCPClient &socket = connect(client);
+  CHECK(client.isConnected());
+
+  CHECK(client.publish("a/b", "on"));
+  const uint8_t expected[] = {MQTTPUBLISH, 7, 0, 3, 'a', '/', 'b', 'o', 'n'};
+  CHECK_EQUAL(sizeof(expected), socket.sent.size());
+  CHECK(memcmp(expected, socket.sent.data(), sizeof(expected)) == 0);
+  CHECK_EQUAL(0, client.getBytesCopied());
+}
+
+TEST(publishQueuesWhatTheSocketWontTake) {
+  SimPlatform sim;
+  MQTT client((char*)"broker", 1883, onMessage);
+  TCPClient &socket = connect(client);
+
+  socket.setWindow(4);
+  CHECK(client.publish("a/b", "on"));
+  CHECK_EQUAL(4, socket.sent.size());
+  CHECK_EQUAL(5, client.getQueuedBytes());
+
+  socket.setWindow(100);
+  client.loop();
+  CHECK_EQUAL(9, socket.sent.size());
+  CHECK_EQUAL(0, client.getQueuedBytes());
+}
+
+TEST(disconnectSendsWhatIsQueuedThenDisconnect) {
+  SimPlatform sim;
+  MQTT client((char*)"broker", 1883, onMessage);
+  TCPClient &socket = connect(client);
+
+  socket.setWindow(0);
+  CHECK(client.publish("a/b", "on"));
+  CHECK(client.getQueuedBytes() > 0);
+
+  client.disconnect();
+  CHECK(!client.isConnected());
+  const uint8_t expected[] = {MQTTPUBLISH, 7, 0, 3, 'a', '/', 'b', 'o', 'n', MQTTDISCONNECT, 0};
+  CHECK_EQUAL(sizeof(expected), socket.sent.size());
+  CHECK(memcmp(expected, socket.sent.data(), sizeof(expected)) == 0);
+}
+
+static SimPlatform *callbackSim;
+static void slowCallback(char *topic, uint8_t *payload, unsigned int length) {
+  callbackSim->advance(1000);
+}
+
+TEST(parseCounterLeavesOutIdleLoopsAndTheCallback) {
+  SimPlatform sim;
+  callbackSim = &sim;
+  MQTT client((char*)"broker", 1883, slowCallback);
+  TCPClient &socket = connect(client);
+  perfReset();
+
+  client.loop();
+  CHECK_EQUAL(0, perfCounters[PERF_MQTT_PARSE].count());
+
+  const uint8_t publish[] = {MQTTPUBLISH, 7, 0, 3, 'a', '/', 'b', 'o', 'n'};
+  socket.receive(publish, sizeof(publish));
+  client.loop();
+  CHECK_EQUAL(1, perfCounters[PERF_MQTT_PARSE].count());
+  CHECK(perfCounters[PERF_MQTT_PARSE].max() < 1000 * sim.ticksPerMicrosecond());
+  perfReset();
+}
+
+TEST(packetSplitAcrossLoopsIsPutBackTogether) {
+  SimPlatform sim;
+  messages = 0;
+  MQTT client((char*)"broker", 1883, recordMessage);
+  TCPClient &socket = connect(client);
+
+  const uint8_t publish[] = {MQTTPUBLISH, 7, 0, 3, 'a', '/', 'b', 'o', 'n'};
+  // The header, the length, then the body a couple of bytes at a time
+  const size_t cuts[] = {1, 2, 4, 7, sizeof(publish)};
+  size_t from = 0;
+  for (size_t i = 0; i < sizeof(cuts) / sizeof(cuts[0]); i++) {
+    CHECK_EQUAL(0, messages);
+    socket.receive(publish + from, cuts[i] - from);
+    client.loop();
+    from = cuts[i];
+  }
+  CHECK_EQUAL(1, messages);
+  CHECK(lastTopic == "a/b");
+  CHECK(lastPayload == "on");
+  CHECK(client.isConnected());
+}
+
+TEST(remainingLengthOverTwoBytesIsDecoded) {
+  SimPlatform sim;
+  messages = 0;
+  MQTT client((char*)"broker", 1883, recordMessage);
+  TCPClient &socket = connect(client);
+
+  // 200 bytes of remaining length is 0xC8 0x01 on the wire
+  std::vector<uint8_t> publish = {MQTTPUBLISH, 0xC8, 0x01, 0, 3, 'a', '/', 'b'};
+  publish.resize(3 + 200, 'x');
+  socket.receive(publish.data(), publish.size());
+  client.loop();
+  CHECK_EQUAL(1, messages);
+  CHECK(lastTopic == "a/b");
+  CHECK_EQUAL(200 - 5, lastPayload.size());
+  CHECK(client.isConnected());
+}
+
+TEST(oversizePacketIsDroppedAndTheNextOneStillParses) {
+  SimPlatform sim;
+  messages = 0;
+  MQTT client((char*)"broker", 1883, recordMessage);
+  TCPClient &socket = connect(client);
+
+  // 300 bytes won't fit MQTT_MAX_PACKET_SIZE
+  std::vector<uint8_t> big = {MQTTPUBLISH, 0xAC, 0x02, 0, 3, 'b', 'i', 'g'};
+  big.resize(3 + 300, 'x');
+  socket.receive(big.data(), big.size());
+  const uint8_t publish[] = {MQTTPUBLISH, 7, 0, 3, 'a', '/', 'b', 'o', 'n'};
+  socket.receive(publish, sizeof(publish));
+  client.loop();
+  CHECK_EQUAL(1, messages);
+  CHECK(lastTopic == "a/b");
+  CHECK(lastPayload == "on");
+  CHECK(client.isConnected());
+}
+
+TEST(topicLongerThanThePacketClosesTheSession) {
+  SimPlatform sim;
+  messages = 0;
+  MQTT client((char*)"broker", 1883, recordMessage);
+  TCPClient &socket = connect(client);
+
+  const uint8_t publish[] = {MQTTPUBLISH, 7, 0xFF, 0xFF, 'a', '/', 'b', 'o', 'n'};
+  socket.receive(publish, sizeof(publish));
+  client.loop();
+  CHECK_EQUAL(0, messages);
+  CHECK(!client.isConnected());
+}
+
+TEST(qos1MsgIdPastThePacketClosesTheSession) {
+  SimPlatform sim;
+  messages = 0;
+  MQTT client((char*)"broker", 1883, recordMessage);
+  TCPClient &socket = connect(client);
+
+  // A QoS 1 topic that runs right up to the end leaves no room for the msgId
+  const uint8_t publish[] = {(MQTTPUBLISH) | 0x02, 5, 0, 3, 'a', '/', 'b'};
+  socket.receive(publish, sizeof(publish));
+  client.loop();
+  CHECK_EQUAL(0, messages);
+  CHECK(!client.isConnected());
+}
+
+TEST(missingConnackTimesOut) {
+  SimPlatform sim;
+  MQTT client((char*)"broker", 1883, onMessage);
+  CHECK(client.connect("skylight"));
+  CHECK(client.isConnecting());
+
+  sim.advance(MQTT_DEFAULT_KEEPALIVE * 1000000UL);
+  client.loop();
+  CHECK(client.isConnecting());
+
+  sim.advance(1000);
+  client.loop();
+  CHECK(!client.isConnecting());
+  CHECK(!client.isConnected());
+}
+
+TEST(unansweredPingDisconnectsWithoutWaiting) {
+  SimPlatform sim;
+  MQTT client((char*)"broker", 1883, onMessage);
+  TCPClient &socket = connect(client);
+
+  // Nothing either way for a keepalive: PINGREQ goes out
+  sim.advance(MQTT_DEFAULT_KEEPALIVE * 1000000UL + 1000);
+  client.loop();
+  const uint8_t ping[] = {MQTTPINGREQ, 0};
+  CHECK_EQUAL(sizeof(ping), socket.sent.size());
+  CHECK(memcmp(ping, socket.sent.data(), sizeof(ping)) == 0);
+  CHECK(client.isConnected());
+
+  // The broker has gone quiet and its socket stays half open: nothing is
+  // read and nothing more is taken. The next keepalive gives up on it
+  // straight away, without a write that could wait on the socket.
+  socket.setWindow(0);
+  sim.advance(MQTT_DEFAULT_KEEPALIVE * 1000000UL + 1000);
+  uint32_t writes = socket.writes;
+  CHECK(!client.loop());
+  CHECK(!client.isConnected());
+  CHECK_EQUAL(writes, socket.writes);
+}
+
+TEST_MAIN()
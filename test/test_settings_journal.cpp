@@ -0,0 +1,138 @@
+#include <string.h>
+#include "test.h"
+#include "settings_journal.h"
+#include "sim_platform.h"
+
+#define BASE 16
+#define SLOTS 4
+#define PAYLOAD 8
+#define SLOT_SIZE (5 + PAYLOAD + 2)
+
+struct Settings {
+  uint32_t a;
+  uint32_t b;
+};
+
+static Settings settings(uint32_t a) {
+  Settings s = { a, ~a };
+  return s;
+}
+
+static uint32_t loaded(SimPlatform &sim) {
+  SettingsJournal journal(BASE, SLOTS, PAYLOAD);
+  Settings s = settings(0xDEAD);
+  return journal.load(sim, &s) ? s.a : 0xDEAD;
+}
+
+TEST(blankStorageHasNoRecord) {
+  SimPlatform sim;
+  SettingsJournal journal(BASE, SLOTS, PAYLOAD);
+  Settings s = settings(7);
+  CHECK(!journal.load(sim, &s));
+  CHECK_EQUAL(7, s.a);
+}
+
+TEST(newestRecordWinsRoundTheRing) {
+  SimPlatform sim;
+  SettingsJournal journal(BASE, SLOTS, PAYLOAD);
+  for (uint32_t i = 1; i <= SLOTS * 3 + 1; i++) {
+    Settings s = settings(i);
+    journal.save(sim, &s);
+    CHECK_EQUAL(i, loaded(sim));
+  }
+  // Nothing outside the ring is touched
+  CHECK_EQUAL(0xFF, sim.settings()[BASE - 1]);
+  CHECK_EQUAL(0xFF, sim.settings()[BASE + SLOTS * SLOT_SIZE]);
+}
+
+TEST(tornWriteFallsBackToThePreviousRecord) {
+  SimPlatform sim;
+  SettingsJournal journal(BASE, SLOTS, PAYLOAD);
+  for (uint32_t i = 1; i <= SLOTS + 1; i++) {
+    Settings s = settings(i);
+    journal.save(sim, &s);
+  }
+
+  // A reset part way through the next save leaves the new header over the
+  // tail of the record it was replacing
+  uint8_t before[SLOTS * SLOT_SIZE];
+  memcpy(before, sim.settings() + BASE, sizeof(before));
+  Settings s = settings(100);
+  journal.save(sim, &s);
+  int slot = 1;
+  for (int cut = 1; cut < SLOT_SIZE; cut++) {
+    uint8_t torn[SLOTS * SLOT_SIZE];
+    memcpy(torn, sim.settings() + BASE, sizeof(torn));
+    SimPlatform tornSim;
+    memcpy(tornSim.settings() + BASE, before, sizeof(before));
+    memcpy(tornSim.settings() + BASE + slot * SLOT_SIZE, torn + slot * SLOT_SIZE, cut);
+    CHECK_EQUAL(SLOTS + 1, loaded(tornSim));
+  }
+  CHECK_EQUAL(100, loaded(sim));
+}
+
+TEST(corruptRecordsAreSkipped) {
+  SimPlatform sim;
+  SettingsJournal journal(BASE, SLOTS, PAYLOAD);
+  for (uint32_t i = 1; i <= 3; i++) {
+    Settings s = settings(i);
+    journal.save(sim, &s);
+  }
+
+  uint8_t *newest = sim.settings() + BASE + 2 * SLOT_SIZE;
+  // A flipped payload bit fails the CRC
+  newest[5] ^= 0x10;
+  CHECK_EQUAL(2, loaded(sim));
+  newest[5] ^= 0x10;
+  CHECK_EQUAL(3, loaded(sim));
+
+  // So does a record from another format version or payload size, even with
+  // a CRC that matches
+  newest[1]++;
+  CHECK_EQUAL(2, loaded(sim));
+  newest[1]--;
+  newest[4]++;
+  CHECK_EQUAL(2, loaded(sim));
+  newest[4]--;
+
+  // With every record bad there is nothing to load
+  for (int slot = 0; slot < SLOTS; slot++)
+    sim.settings()[BASE + slot * SLOT_SIZE] = 0;
+  CHECK_EQUAL(0xDEAD, loaded(sim));
+}
+
+TEST(sequenceNumbersWrap) {
+  SimPlatform sim;
+  SettingsJournal journal(BASE, SLOTS, PAYLOAD);
+  for (uint32_t i = 1; i <= 0x10000 + SLOTS; i++) {
+    Settings s = settings(i);
+    journal.save(sim, &s);
+  }
+  CHECK_EQUAL(0x10000 + SLOTS, loaded(sim));
+}
+
+TEST(reloadedJournalAppendsAfterTheNewest) {
+  SimPlatform sim;
+  {
+    SettingsJournal journal(BASE, SLOTS, PAYLOAD);
+    for (uint32_t i = 1; i <= SLOTS + 2; i++) {
+      Settings s = settings(i);
+      journal.save(sim, &s);
+    }
+  }
+
+  // After a restart the next save must go after the newest record and
+  // outrank it, whatever slot it lands in
+  SettingsJournal journal(BASE, SLOTS, PAYLOAD);
+  Settings s = settings(0);
+  CHECK(journal.load(sim, &s));
+  CHECK_EQUAL(SLOTS + 2, s.a);
+  s = settings(50);
+  journal.save(sim, &s);
+  CHECK_EQUAL(50, loaded(sim));
+  s = settings(51);
+  journal.save(sim, &s);
+  CHECK_EQUAL(51, loaded(sim));
+}
+
+TEST_MAIN()
@@ -0,0 +1,70 @@
+#include <string.h>
+#include "test.h"
+#include "telemetry.h"
+#include "perf_counters.h"
+
+#define METRICS_BUFFER_SIZE 512
+
+static int countOf(const char *haystack, const char *needle) {
+  int n = 0;
+  for (const char *p = strstr(haystack, needle); p; p = strstr(p + 1, needle))
+    n++;
+  return n;
+}
+
+TEST(lineProtocolFormatsFieldsAndEscapes) {
+  char buf[128];
+  LineProtocol line(buf, sizeof(buf));
+  line.measurement("light");
+  line.tag("device", "Sky light");
+  line.fieldUInt("mode", 2);
+  line.fieldInt("delta", -5);
+  line.fieldBool("on", true);
+  line.fieldString("name", "a\"b");
+  CHECK(line.end());
+  CHECK(strcmp("light,device=Sky\\ light mode=2i,delta=-5i,on=true,name=\"a\\\"b\"", line.c_str()) == 0);
+  CHECK_EQUAL(1, line.lines());
+}
+
+TEST(lineThatDoesNotFitIsDroppedWhole) {
+  char buf[32];
+  LineProtocol line(buf, sizeof(buf));
+  line.measurement("a");
+  line.fieldUInt("x", 1);
+  line.measurement("second");
+  line.fieldString("long", "more than the buffer has room for");
+  CHECK(!line.end());
+  CHECK(line.overflowed());
+  CHECK(strcmp("a x=1i", line.c_str()) == 0);
+}
+
+TEST(everyPerfCounterIsReportedFromAFullMetricsBuffer) {
+  for (uint8_t i = 0; i < PERF_COUNTER_COUNT; i++)
+    perfCounters[i].record(UINT32_MAX);
+
+  TelemetryRegistry telemetry;
+  CHECK(perfAddMetrics(telemetry));
+  CHECK_EQUAL(PERF_COUNTER_COUNT, telemetry.size());
+
+  char buf[METRICS_BUFFER_SIZE];
+  LineProtocol line(buf, sizeof(buf));
+  int reported[PERF_COUNTER_COUNT] = {};
+  uint8_t next = 0, batches = 0;
+  while (next < telemetry.size()) {
+    line.clear();
+    next = telemetry.collect(line, next);
+    batches++;
+    for (uint8_t i = 0; i < PERF_COUNTER_COUNT; i++) {
+      char tag[32];
+      snprintf(tag, sizeof(tag), "counter=%s ", perfCounterName(i));
+      reported[i] += countOf(line.c_str(), tag);
+    }
+  }
+
+  for (uint8_t i = 0; i < PERF_COUNTER_COUNT; i++)
+    CHECK_EQUAL(1, reported[i]);
+  CHECK(batches >= 2);
+  perfReset();
+}
+
+TEST_MAIN()
@@ -0,0 +1,100 @@
+#include "test.h"
+#include "topic_router.h"
+
+#include <string>
+
+static std::string called, calledTopic;
+
+static void onExact(const char *topic, char *payload, unsigned int length) { called = "exact"; calledTopic = topic; }
+static void onLevel(const char *topic, char *payload, unsigned int length) { called = "+"; calledTopic = topic; }
+static void onRest(const char *topic, char *payload, unsigned int length) { called = "#"; calledTopic = topic; }
+
+static bool route(const TopicRouter &router, const char *topic) {
+  called.clear();
+  calledTopic.clear();
+  char payload[] = "on";
+  return router.dispatch(topic, payload, sizeof(payload) - 1);
+}
+
+TEST(exactSegmentBeatsPlus) {
+  TopicRouter router("home/skylight");
+  // Registered wildcard first, so the order of add() doesn't decide it
+  CHECK(router.add("+/set", onLevel));
+  CHECK(router.add("power/set", onExact));
+
+  CHECK(route(router, "home/skylight/power/set"));
+  CHECK(called == "exact");
+  CHECK(calledTopic == "power/set");
+
+  CHECK(route(router, "home/skylight/mode/set"));
+  CHECK(called == "+");
+  CHECK(calledTopic == "mode/set");
+}
+
+TEST(hashIsTheFallback) {
+  TopicRouter router("dev");
+  CHECK(router.add("#", onRest));
+  CHECK(router.add("power/set", onExact));
+  CHECK(router.add("+/get", onLevel));
+
+  CHECK(route(router, "dev/power/set"));
+  CHECK(called == "exact");
+  CHECK(route(router, "dev/mode/get"));
+  CHECK(called == "+");
+  CHECK(route(router, "dev/power/set/extra"));
+  CHECK(called == "#");
+  CHECK(route(router, "dev/anything"));
+  CHECK(called == "#");
+}
+
+TEST(hashAlsoMatchesItsParentLevel) {
+  TopicRouter router("dev");
+  CHECK(router.add("a/#", onRest));
+
+  CHECK(route(router, "dev/a"));
+  CHECK(called == "#");
+  CHECK(route(router, "dev/a/b/c"));
+  CHECK(called == "#");
+  CHECK(!route(router, "dev/b"));
+}
+
+TEST(hashOutsideTheLastLevelIsRejected) {
+  TopicRouter router("dev");
+  CHECK(!router.add("#/a", onRest));
+  CHECK(!router.add("a/#/b", onRest));
+  CHECK(!route(router, "dev/a/x/b"));
+}
+
+TEST(topicOutsideThePrefixIsRefused) {
+  TopicRouter router("home/skylight");
+  CHECK(router.add("#", onRest));
+
+  CHECK(!route(router, "home/other/power"));
+  // The prefix has to end at a level
+  CHECK(!route(router, "home/skylightx/power"));
+  CHECK(!route(router, "home/skylight"));
+  CHECK(called.empty());
+
+  CHECK(route(router, "home/skylight/power"));
+  CHECK(calledTopic == "power");
+}
+
+TEST(fullNodePoolFailsTheAdd) {
+  TopicRouter router("dev");
+  static char patterns[TOPIC_ROUTER_MAX_NODES][8];
+  for (int i = 0; i < TOPIC_ROUTER_MAX_NODES; i++) {
+    snprintf(patterns[i], sizeof(patterns[i]), "p%d", i);
+    CHECK(router.add(patterns[i], onExact));
+  }
+  CHECK(!router.add("one/more", onExact));
+  // Levels already in the pool still take a handler
+  CHECK(router.add("p0", onLevel));
+
+  CHECK(route(router, "dev/p0"));
+  CHECK(called == "+");
+  CHECK(route(router, "dev/p23"));
+  CHECK(called == "exact");
+  CHECK(!route(router, "dev/one/more"));
+}
+
+TEST_MAIN()